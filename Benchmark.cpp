@@ -0,0 +1,502 @@
+// Microbenchmarks for the packet generator
+// Build: g++ -std=c++20 -O2 -pthread Benchmark.cpp -o Benchmark
+// Usage: Benchmark [--quick] [--save baseline.csv] [--compare baseline.csv] [--tolerance percent]
+//   --save     store the ns/packet of every stage and capture config
+//   --compare  flag results slower than the stored baseline by more than the tolerance (default 10 %), exit code 2
+
+#define MILESTONE2_NO_MAIN
+#include "Milestone2.cpp"
+
+#include <chrono>
+#include <random>
+#include <map>
+
+// Keeps the optimizer from dropping the measured work
+static volatile uint32_t benchmarkSink;
+
+// Time spent on each measurement
+static double benchmarkSeconds = 0.5;
+
+struct BenchmarkResult
+{
+    std::string name;
+    double nsPerPacket;
+};
+
+static std::vector<BenchmarkResult> benchmarkResults;
+
+// Print one result line: ns per packet, packets per second and the equivalent bit rate of `bytesPerPacket`
+void Report(const std::string& name, double nsPerPacket, double bytesPerPacket)
+{
+    cout << "  " << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(1)
+         << std::setw(10) << nsPerPacket << " ns/packet" << std::setw(10) << std::setprecision(3) << 1e3 / nsPerPacket
+         << " Mpackets/s" << std::setw(9) << std::setprecision(2) << bytesPerPacket * 8 / nsPerPacket << " Gbit/s" << endl;
+    benchmarkResults.push_back({ name, nsPerPacket });
+}
+
+// Run `body` (one packet, or `packetsPerCall` packets) repeatedly for benchmarkSeconds and report the cost per packet
+template <typename Body>
+void MeasurePerPacket(const std::string& name, double bytesPerPacket, Body body, size_t packetsPerCall = 1)
+{
+    body();  // warm-up
+    size_t packets = 0;
+    double seconds = 0;
+    auto start = std::chrono::steady_clock::now();
+    do
+    {
+        for (int i = 0; i < 64; ++i)
+        {
+            body();
+        }
+        packets += 64 * packetsPerCall;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < benchmarkSeconds);
+    Report(name, seconds * 1e9 / packets, bytesPerPacket);
+}
+
+// Measure one CRC variant over buffers of the given size and print GB/s
+void BenchmarkCRC32(CRC32Engine::Variant variant, const std::vector<uint8_t>& buffer, size_t blockSize)
+{
+    const size_t totalBytes = 256ull << 20; // 256 MiB per measurement
+    size_t blocks = buffer.size() / blockSize;
+    size_t iterations = totalBytes / blockSize;
+
+    uint32_t crc = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        crc ^= CRC32Engine::Compute(buffer.data() + (i % blocks) * blockSize, blockSize, variant);
+    }
+    auto stop = std::chrono::steady_clock::now();
+    benchmarkSink = crc;
+
+    double seconds = std::chrono::duration<double>(stop - start).count();
+    cout << "  " << std::left << std::setw(12) << CRC32Engine::Name(variant) << std::right
+         << std::setw(8) << blockSize << " B blocks: " << std::fixed << std::setprecision(2)
+         << (iterations * blockSize) / seconds / 1e9 << " GB/s" << endl;
+}
+
+// Cost of each packet-building stage for one ORAN packet of `numPrb` PRBs
+void BenchmarkStages(const std::vector<uint8_t>& iq, int numPrb)
+{
+    std::vector<uint8_t> payload(iq.begin(), iq.begin() + numPrb * IQSampleStore::BytesPerPRB);
+    IQView payloadView = IQView::Contiguous(payload.data(), payload.size());
+
+    ORAN_Packet packet;
+    packet.DestAddress = 0x010101010101;
+    packet.SourceAddress = 0x333333333333;
+    packet.numPrbu = static_cast<uint8_t>(numPrb);
+
+    std::vector<uint8_t> oranBytes = packet.GenerateORANPacket(payload, 0);
+    std::vector<uint8_t> ecpriBytes = packet.GenerateECPRIPacket(oranBytes);
+    std::vector<uint8_t> frame = packet.GenerateEthernetPackets(ecpriBytes);
+    double frameBytes = static_cast<double>(frame.size());
+
+    cout << "Packet stages, " << numPrb << " PRBs per packet (" << frame.size() << " byte frames):" << endl;
+
+    MeasurePerPacket("GenerateORANPacket", frameBytes, [&]()
+    {
+        benchmarkSink = packet.GenerateORANPacket(payload, 0).size();
+    });
+    MeasurePerPacket("GenerateECPRIPacket", frameBytes, [&]()
+    {
+        benchmarkSink = packet.GenerateECPRIPacket(oranBytes).size();
+    });
+    MeasurePerPacket("GenerateEthernetPackets", frameBytes, [&]()
+    {
+        benchmarkSink = packet.GenerateEthernetPackets(ecpriBytes).size();
+    });
+    MeasurePerPacket("ComputeCRC32", frameBytes, [&]()
+    {
+        benchmarkSink = CRC32Engine::Compute(frame.data() + EthernetPacket::PreambleSize,
+                                             frame.size() - EthernetPacket::PreambleSize - EthernetPacket::FCSSize);
+    });
+    std::vector<uint8_t> padded = frame;
+    MeasurePerPacket("AddIFG", frameBytes, [&]()
+    {
+        padded.resize(frame.size());
+        packet.AddIFG(padded);
+        benchmarkSink = padded.size();
+    });
+    MeasurePerPacket("legacy chain (ORAN+eCPRI+Ethernet+IFG)", frameBytes, [&]()
+    {
+        std::vector<uint8_t> built = packet.GenerateEthernetPackets(packet.GenerateECPRIPacket(packet.GenerateORANPacket(payload, 0)));
+        packet.AddIFG(built);
+        benchmarkSink = built.size();
+    });
+
+    std::vector<uint8_t> buffer(frame.size() + 64);
+    MeasurePerPacket("EncodeFrame (in place)", frameBytes, [&]()
+    {
+        benchmarkSink = packet.EncodeFrame(buffer.data(), payloadView);
+    });
+    FrameTemplate frameTemplate;
+    frameTemplate.Build(packet, payloadView);
+    uint8_t seqId = 0;
+    MeasurePerPacket("FrameTemplate::Patch", frameBytes, [&]()
+    {
+        packet.SymbolID = (packet.SymbolID + 1) % 14;
+        benchmarkSink = frameTemplate.Patch(packet, seqId++)[EthernetPacket::PayloadOffset + 5];
+    });
+
+    // Output writers, to /dev/null so only the formatting and buffering are measured
+    const char* formats[] = { "text", "pcap", "pcapng" };
+    for (const char* format : formats)
+    {
+        std::unique_ptr<PacketSink> sink = CreatePacketSink(format);
+        sink->Open("/dev/null");
+        uint64_t timestamp = 0;
+        MeasurePerPacket(std::string("PacketSink ") + format, frameBytes, [&]()
+        {
+            sink->WritePacket(frame.data(), frame.size(), timestamp);
+            sink->EndGroup();
+            timestamp += 1000;
+        });
+        sink->Close();
+    }
+}
+
+// PRB-aligned fragmentation of a whole-symbol ORAN packet: every section of the split plan encoded in place,
+// cost per ORAN packet
+void BenchmarkFragmentation(const std::vector<uint8_t>& iq, int numPrb, int maxPacketSize)
+{
+    MaxPacketSize = maxPacketSize;
+    oran_Maxprb = numPrb;
+    oran_nrbPerPacket = numPrb;
+    PacketsPerSymbol = 1;
+
+    IQSampleStore samples;
+    samples.Assign(iq);
+    StreamSet streams;
+    streams.Add(0, 0, &samples);
+    CaptureGenerator generator;
+    generator.Setup(streams, true, false, 0x010101010101, 0x333333333333, IQCompressor());
+    const std::vector<SectionFragment>& fragments = generator.Fragments();
+
+    ORAN_Packet packet;
+    packet.DestAddress = 0x010101010101;
+    packet.SourceAddress = 0x333333333333;
+    std::vector<uint8_t> buffer(fragments.size() * maxPacketSize + 64);
+    size_t oranBytes = generator.Layout()[0].oranSize;
+
+    cout << "Fragmentation of a " << oranBytes << " byte ORAN packet into " << fragments.size()
+         << " sections, Eth.MaxPacketSize " << maxPacketSize << ":" << endl;
+    MeasurePerPacket("sections encoded in place mtu" + std::to_string(maxPacketSize), static_cast<double>(oranBytes), [&]()
+    {
+        size_t used = 0;
+        for (const SectionFragment& fragment : fragments)
+        {
+            packet.startPrbu = fragment.startPrb;
+            packet.numPrbu = fragment.numPrb > 255 ? 0 : fragment.numPrb;
+            used += packet.EncodeFrame(buffer.data() + used, samples.PRBView(0, fragment.startPrb, fragment.numPrb, numPrb));
+        }
+        benchmarkSink = used;
+    });
+}
+
+// IQ compression of one 273-PRB symbol, cost per PRB (Gbit/s of uncompressed samples)
+void BenchmarkCompression(const std::vector<uint8_t>& iq)
+{
+    const size_t prbs = 273;
+    std::vector<uint8_t> out(prbs * IQSampleStore::BytesPerPRB);
+    cout << "IQ compression, per PRB:" << endl;
+    const std::pair<const char*, int> settings[] = { { "bfp", 8 }, { "bfp", 9 }, { "bfp", 12 }, { "bfp", 14 }, { "none", 8 }, { "none", 12 } };
+    for (const auto& setting : settings)
+    {
+        IQCompressor compressor;
+        IQCompressor::Parse(setting.first, setting.second, compressor);
+        std::ostringstream name;
+        name << "IQCompressor " << setting.first << " " << setting.second << "-bit";
+        MeasurePerPacket(name.str(), IQSampleStore::BytesPerPRB, [&]()
+        {
+            compressor.Compress(iq.data(), prbs, out.data());
+            benchmarkSink = out[0];
+        }, prbs);
+    }
+}
+
+// Built-in payload generators filling one 273-PRB symbol, cost per PRB (Gbit/s of generated samples)
+void BenchmarkPayloadGenerators()
+{
+    const uint32_t prbs = 273;
+    std::vector<uint8_t> out(prbs * IQSampleStore::BytesPerPRB);
+    cout << "IQ payload generators, per PRB:" << endl;
+    for (const char* type : { "random", "qpsk", "qam256", "tone", "pattern" })
+    {
+        IQPayloadGenerator generator;
+        IQPayloadGenerator::Parse(type, 1, 64, generator);
+        uint64_t symbol = 0;
+        MeasurePerPacket(std::string("IQPayloadGenerator ") + type, IQSampleStore::BytesPerPRB, [&]()
+        {
+            generator.Generate(out.data(), 0, symbol++, 0, prbs, prbs);
+            benchmarkSink = out[0];
+        }, prbs);
+    }
+}
+
+// Slot encoding with the generic CaptureGenerator and the compile-time specialized pipeline for the same
+// 30 kHz, 273-PRB setup, cost per Ethernet frame
+void BenchmarkSlotEncoders(const std::vector<uint8_t>& iq, int nrbPerPacket, int maxPacketSize)
+{
+    MaxPacketSize = maxPacketSize;
+    oran_scs = 30;
+    slots = 2;
+    oran_Maxprb = 273;
+    oran_nrbPerPacket = nrbPerPacket;
+    oran_iqWidth = 16;
+    PacketsPerSymbol = (273 + nrbPerPacket - 1) / nrbPerPacket;
+
+    IQSampleStore samples;
+    samples.Assign(iq);
+    StreamSet streams;
+    streams.Add(0, 0, &samples);
+    CaptureGenerator generator;
+    generator.Setup(streams, false, false, 0x010101010101, 0x333333333333, IQCompressor());
+    std::unique_ptr<SlotEncoder> specialized = CreateFixedSlotEncoder(generator);
+    EncoderState state;
+    PacketBatch batch;
+
+    cout << "Slot encoders, " << nrbPerPacket << " PRBs per packet, Eth.MaxPacketSize " << maxPacketSize << ":" << endl;
+    const size_t framesPerSlot = static_cast<size_t>(generator.FramesPerSymbol()) * 14;
+    const double bytesPerFrame = static_cast<double>(generator.MaxSlotBytes()) / framesPerSlot;
+    const SlotEncoder* encoders[] = { &generator, specialized.get() };
+    for (const SlotEncoder* encoder : encoders)
+    {
+        int slot = 0;
+        MeasurePerPacket(std::string(encoder->Name()) + " nrb" + std::to_string(nrbPerPacket) + " mtu" + std::to_string(maxPacketSize),
+                         bytesPerFrame, [&]()
+        {
+            encoder->EncodeSlot(0, slot / 2 % 10, slot % 2, state, batch);
+            ++slot;
+            benchmarkSink = static_cast<uint32_t>(batch.used);
+        }, framesPerSlot);
+    }
+}
+
+// Setup file parameters of one end-to-end capture
+struct CaptureConfig
+{
+    int scs;
+    int nrbPerPacket;
+    int maxPacketSize;
+};
+
+// Generate a whole capture the way main() does with one thread and Output.Format=pcap to /dev/null;
+// cost per Ethernet frame
+void BenchmarkCapture(const std::vector<uint8_t>& iq, const CaptureConfig& config)
+{
+    LineRate = 10;
+    CaptureSizeMs = 20;
+    MinNumOfIFGsPerPacket = 1;
+    MaxPacketSize = config.maxPacketSize;
+    oran_scs = config.scs;
+    oran_Maxprb = 273;
+    oran_nrbPerPacket = config.nrbPerPacket;
+
+    // Calculations() reports to the console
+    std::streambuf* console = cout.rdbuf(nullptr);
+    Calculations();
+    cout.rdbuf(console);
+
+    IQSampleStore samples;
+    samples.Assign(iq);
+    StreamSet streams;
+    streams.Add(0, 0, &samples);
+    CaptureGenerator generator;
+    generator.Setup(streams, false, false, 0x010101010101, 0x333333333333, IQCompressor());
+    EncoderState state;
+    PacketBatch batch;
+    PacketScheduler scheduler;
+
+    size_t frames = 0, bytes = 0;
+    double seconds = 0;
+    auto start = std::chrono::steady_clock::now();
+    do
+    {
+        PcapPacketSink sink;
+        sink.Open("/dev/null");
+        scheduler.Configure(LineRate, MinNumOfIFGsPerPacket, 0, 0, PacketScheduler::Frame, slots);
+        for (int frameId = 0; frameId < No_of_Frames; ++frameId)
+        {
+            for (int subframeId = 0; subframeId < 10; ++subframeId)
+            {
+                for (int slotId = 0; slotId < slots; ++slotId)
+                {
+                    generator.EncodeSlot(frameId, subframeId, slotId, state, batch);
+                    for (PacketBatch::Packet& packet : batch.packets)
+                    {
+                        packet.timestampNs = scheduler.Schedule(packet.length);
+                        sink.WritePacket(batch.bytes.data() + packet.offset, packet.length, packet.timestampNs);
+                    }
+                    frames += batch.packets.size();
+                    bytes += batch.used;
+                }
+            }
+        }
+        sink.Close();
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < benchmarkSeconds);
+
+    std::ostringstream name;
+    name << "capture scs" << config.scs << " nrb" << config.nrbPerPacket << " mtu" << config.maxPacketSize;
+    Report(name.str(), seconds * 1e9 / frames, static_cast<double>(bytes) / frames);
+}
+
+// Baseline file: one "name,ns_per_packet" line per result
+bool SaveBaseline(const std::string& path)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cerr << "Error opening baseline file " << path << std::endl;
+        return false;
+    }
+    file << "name,ns_per_packet\n";
+    for (const BenchmarkResult& result : benchmarkResults)
+    {
+        file << result.name << "," << std::setprecision(6) << result.nsPerPacket << "\n";
+    }
+    return true;
+}
+
+// Compare with a stored baseline; returns the number of regressions, -1 if the file cannot be read
+int CompareBaseline(const std::string& path, double tolerance)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << "Error opening baseline file " << path << std::endl;
+        return -1;
+    }
+    std::map<std::string, double> baseline;
+    std::string line;
+    std::getline(file, line);  // header
+    while (std::getline(file, line))
+    {
+        size_t comma = line.rfind(',');
+        if (comma != std::string::npos)
+        {
+            baseline[line.substr(0, comma)] = std::stod(line.substr(comma + 1));
+        }
+    }
+
+    int regressions = 0;
+    cout << "Comparison with " << path << " (tolerance " << tolerance << " %):" << endl;
+    for (const BenchmarkResult& result : benchmarkResults)
+    {
+        auto stored = baseline.find(result.name);
+        if (stored == baseline.end())
+            continue;
+        double change = (result.nsPerPacket / stored->second - 1) * 100;
+        bool regression = change > tolerance;
+        regressions += regression;
+        cout << "  " << std::left << std::setw(40) << result.name << std::right << std::fixed << std::setprecision(1)
+             << std::setw(8) << change << " %" << (regression ? "  REGRESSION" : "") << endl;
+    }
+    return regressions;
+}
+
+int main(int argc, char* argv[])
+{
+    bool quick = false;
+    std::string savePath, comparePath;
+    double tolerance = 10;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--quick")
+            quick = true;
+        else if (arg == "--save" && i + 1 < argc)
+            savePath = argv[++i];
+        else if (arg == "--compare" && i + 1 < argc)
+            comparePath = argv[++i];
+        else if (arg == "--tolerance" && i + 1 < argc)
+            tolerance = std::stod(argv[++i]);
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--quick] [--save baseline.csv] [--compare baseline.csv] [--tolerance percent]" << std::endl;
+            return 1;
+        }
+    }
+    if (quick)
+    {
+        benchmarkSeconds = 0.1;
+    }
+
+    std::vector<uint8_t> buffer(1 << 20);
+    std::mt19937 rng(1234);
+    for (uint8_t& byte : buffer)
+    {
+        byte = static_cast<uint8_t>(rng());
+    }
+
+    std::vector<CRC32Engine::Variant> variants = { CRC32Engine::Bitwise, CRC32Engine::SliceBy8, CRC32Engine::SliceBy16 };
+    if (CRC32Engine::CarrylessMultiplySupported())
+    {
+        variants.push_back(CRC32Engine::CarrylessMultiply);
+    }
+
+    // All variants have to agree with the bitwise reference, including on odd lengths
+    for (size_t length : { 0, 1, 15, 63, 64, 65, 127, 1500, 1522, 9000 })
+    {
+        uint32_t expected = CRC32Engine::Compute(buffer.data() + 3, length, CRC32Engine::Bitwise);
+        for (CRC32Engine::Variant variant : variants)
+        {
+            if (CRC32Engine::Compute(buffer.data() + 3, length, variant) != expected)
+            {
+                std::cerr << "CRC mismatch for " << CRC32Engine::Name(variant) << " at length " << length << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    if (!quick)
+    {
+        cout << "CRC32 (IEEE 802.3 FCS), best variant on this CPU: " << CRC32Engine::Name(CRC32Engine::Best()) << endl;
+        for (size_t blockSize : { 64, 1500, 9000, 65536 })
+        {
+            for (CRC32Engine::Variant variant : variants)
+            {
+                BenchmarkCRC32(variant, buffer, blockSize);
+            }
+        }
+    }
+
+    BenchmarkStages(buffer, 30);
+    BenchmarkFragmentation(buffer, 273, 1500);
+    BenchmarkFragmentation(buffer, 273, 9000);
+    BenchmarkCompression(buffer);
+    BenchmarkPayloadGenerators();
+    BenchmarkSlotEncoders(buffer, 46, 1500);
+    BenchmarkSlotEncoders(buffer, 273, 9000);
+
+    // Representative setup files: every SCS, small to whole-carrier packets, standard and jumbo MTU
+    cout << "End-to-end capture (20 ms, 273 PRBs, one thread, pcap to /dev/null), per Ethernet frame:" << endl;
+    for (int scs : { 15, 30, 60 })
+    {
+        for (int nrbPerPacket : { 10, 46, 106, 273 })
+        {
+            for (int maxPacketSize : { 1500, 9000 })
+            {
+                if (quick && (nrbPerPacket == 10 || nrbPerPacket == 106))
+                    continue;
+                BenchmarkCapture(buffer, { scs, nrbPerPacket, maxPacketSize });
+            }
+        }
+    }
+
+    if (!savePath.empty() && !SaveBaseline(savePath))
+    {
+        return 1;
+    }
+    if (!comparePath.empty())
+    {
+        int regressions = CompareBaseline(comparePath, tolerance);
+        if (regressions != 0)
+        {
+            return regressions < 0 ? 1 : 2;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,406 @@
+// Rebuilds the IQ resource grid of one eAxC stream from a capture written by Milestone2 (text, pcap or pcapng)
+// The capture is read window by window, so memory does not grow with it; LZ4 or zstd compressed captures
+// (Output.Compression) have the blocks of each window decoded in parallel
+// Build: g++ -std=c++20 -O2 -pthread GridExtract.cpp -o GridExtract
+// Usage: GridExtract [--setup SetupFile.txt] [--threads n] [--eaxc id] [--compare iq_file|generated] capture grid.bin
+//   --setup    setup file of the run (default: SetupFile.txt)
+//   --threads  decoding threads, 0 = one per CPU (default)
+//   --eaxc     stream to extract (default: the stream of the first frame)
+//   --compare  IQ file the capture was generated from (ORAN.PayloadType of the setup), or `generated` for a
+//              built-in payload type: reports the values that differ and the EVM, exit code 2 if the grid is not
+//              bit-exact
+// grid.bin holds one row per symbol, from the first slot of the capture: ORAN.MaxNRB * 12 subcarriers of
+// little-endian int16 I then Q, the layout of a .bin IQ file. PRBs missing from the capture are zero
+
+#define MILESTONE2_NO_MAIN
+#include "Milestone2.cpp"
+
+#include <cstdlib>
+
+// One section of the extracted stream (a frame of its own, fragments included): its place in the grid
+struct GridPacket
+{
+    int64_t symbol;        // absolute symbol index, FrameID unwrapped
+    uint16_t startPrb;
+    uint16_t numPrb;
+    uint32_t frame;        // in the capture
+};
+
+// Differences between the decoded grid and the source samples
+struct GridComparison
+{
+    uint64_t values = 0;
+    uint64_t differentValues = 0;
+    double errorPower = 0;
+    double referencePower = 0;
+
+    void Add(const GridComparison& other)
+    {
+        values += other.values;
+        differentValues += other.differentValues;
+        errorPower += other.errorPower;
+        referencePower += other.referencePower;
+    }
+};
+
+// Samples the capture was generated from: the IQ file, read as ORAN.PayloadType says, or the built-in generator
+struct GridReference
+{
+    const IQSampleStore* samples = nullptr;
+    const IQPayloadGenerator* generator = nullptr;
+    bool streamPayload = false;
+
+    bool Enabled() const { return samples || generator; }
+};
+
+// Decodes the grid slot by slot: the packets are indexed once in capture order, then each window of slots is
+// decoded in parallel (one slot per task) into a preallocated grid with 64-byte aligned rows and written out
+// before the next window, so memory does not grow with the capture. The capture is read again for each window of
+// slots, from its first frame to its last (CaptureReader::Load)
+class ResourceGridDecoder
+{
+public:
+    ResourceGridDecoder(CaptureReader& capture, const IQCompressor& compression)
+        : capture(capture), compression(compression)
+    {
+        prbs = static_cast<int>(oran_Maxprb);
+        rowBytes = static_cast<size_t>(prbs) * IQSampleStore::BytesPerPRB;
+        rowStride = (rowBytes + 63) / 64 * 64;
+        sectionSize = ORAN_Packet::HeaderSize + (compression.Legacy() ? 0 : ORAN_Packet::CompressionHeaderSize);
+    }
+
+    // Read the capture and find the sections of stream `eAxC` (-1: the stream of the first frame)
+    void Index(int eAxC)
+    {
+        const std::vector<CaptureReader::Frame>& frames = capture.Frames();
+        const size_t minimum = EthernetPacket::HeaderSize + eCPRI_Packet::HeaderSize + EthernetPacket::FCSSize;
+        const int64_t period = 256ll * 10 * slots * 14;  // FrameID wraps at 256
+        int64_t lastPosition = -1, symbol = 0;
+        size_t i = 0;
+        while (capture.NextWindow())
+        {
+            for (; i < capture.WindowLast(); ++i)
+            {
+                const uint8_t* bytes = capture.FrameData(frames[i]);
+                if (frames[i].length < minimum)
+                    continue;
+                const uint8_t* ecpri = bytes + EthernetPacket::HeaderSize;
+                if (eAxC < 0)
+                    eAxC = ecpri[4];
+                if (ecpri[4] != eAxC)
+                    continue;
+                size_t size = frames[i].length - minimum;
+                if (size < sectionSize)
+                {
+                    ++malformed;
+                    continue;
+                }
+                const uint8_t* h = ecpri + eCPRI_Packet::HeaderSize;
+                int subframeId = h[2] >> 4, slotId = (h[2] & 0x0F) << 2 | h[3] >> 6, symbolId = h[3] & 0x3F;
+                int startPrb = (h[5] & 0x03) << 8 | h[6];
+                int numPrb = h[7] == 0 ? prbs : h[7];
+                if (subframeId >= 10 || slotId >= slots || symbolId >= 14 || startPrb + numPrb > prbs)
+                {
+                    ++malformed;
+                    continue;
+                }
+                int64_t position = ((static_cast<int64_t>(h[1]) * 10 + subframeId) * slots + slotId) * 14 + symbolId;
+                if (lastPosition < 0)
+                    symbol = position;
+                else
+                {
+                    int64_t step = (position - lastPosition + period) % period;
+                    symbol += step <= period / 2 ? step : step - period;
+                }
+                lastPosition = position;
+
+                packets.push_back({ symbol, static_cast<uint16_t>(startPrb), static_cast<uint16_t>(numPrb), static_cast<uint32_t>(i) });
+            }
+        }
+        stream = eAxC;
+
+        // Slots in the order of the grid, packets of a slot together
+        std::stable_sort(packets.begin(), packets.end(), [](const GridPacket& a, const GridPacket& b) { return a.symbol < b.symbol; });
+        if (!packets.empty())
+        {
+            firstSlot = FloorDiv(packets.front().symbol, 14);
+            slotCount = static_cast<size_t>(FloorDiv(packets.back().symbol, 14) - firstSlot + 1);
+        }
+    }
+
+    // Decode every slot and write the rows to `output`; with a reference, compare each packet to its source samples.
+    // False if the capture cannot be read again
+    bool Run(BufferedFileWriter& output, unsigned threads, const GridReference& reference)
+    {
+        const size_t window = std::max<size_t>(1, 4 * threads);
+        std::unique_ptr<uint8_t, decltype(&std::free)> grid(
+            static_cast<uint8_t*>(std::aligned_alloc(64, window * 14 * rowStride)), &std::free);
+        std::vector<GridComparison> slotComparison(window);
+
+        size_t next = 0;  // first packet of the window
+        for (size_t windowStart = 0; windowStart < slotCount; windowStart += window)
+        {
+            size_t windowSlots = std::min(window, slotCount - windowStart);
+            std::vector<size_t> bounds(windowSlots + 1, next);
+            for (size_t s = 0; s < windowSlots; ++s)
+            {
+                int64_t end = (firstSlot + static_cast<int64_t>(windowStart + s) + 1) * 14;
+                size_t p = bounds[s];
+                while (p < packets.size() && packets[p].symbol < end)
+                    ++p;
+                bounds[s + 1] = p;
+            }
+            next = bounds[windowSlots];
+            uint32_t firstFrame = UINT32_MAX, lastFrame = 0;
+            for (size_t p = bounds[0]; p < next; ++p)
+            {
+                firstFrame = std::min(firstFrame, packets[p].frame);
+                lastFrame = std::max(lastFrame, packets[p].frame + 1);
+            }
+            if (!capture.Load(firstFrame, lastFrame))
+                return false;
+
+            std::atomic<size_t> claimed(0);
+            auto work = [&]()
+            {
+                for (size_t s; (s = claimed.fetch_add(1)) < windowSlots;)
+                {
+                    slotComparison[s] = GridComparison();
+                    DecodeSlot(grid.get() + s * 14 * rowStride, firstSlot + static_cast<int64_t>(windowStart + s),
+                               bounds[s], bounds[s + 1], reference, slotComparison[s]);
+                }
+            };
+            std::vector<std::thread> workers;
+            for (unsigned t = 1; t < std::min<size_t>(threads, windowSlots); ++t)
+            {
+                workers.emplace_back(work);
+            }
+            work();
+            for (std::thread& worker : workers)
+            {
+                worker.join();
+            }
+
+            for (size_t s = 0; s < windowSlots; ++s)
+            {
+                comparison.Add(slotComparison[s]);
+                for (int symbolId = 0; symbolId < 14; ++symbolId)
+                {
+                    output.Write(grid.get() + (s * 14 + symbolId) * rowStride, rowBytes);
+                }
+            }
+        }
+        return true;
+    }
+
+    int Stream() const { return stream; }
+    size_t Packets() const { return packets.size(); }
+    size_t Rows() const { return slotCount * 14; }
+    size_t RowBytes() const { return rowBytes; }
+    uint64_t Malformed() const { return malformed; }
+    uint64_t Incomplete() const { return incomplete; }
+    const GridComparison& Comparison() const { return comparison; }
+
+private:
+    static int64_t FloorDiv(int64_t a, int64_t b) { return a >= 0 ? a / b : -((-a + b - 1) / b); }
+
+    void DecodeSlot(uint8_t* rows, int64_t slot, size_t begin, size_t end, const GridReference& reference, GridComparison& result)
+    {
+        for (int symbolId = 0; symbolId < 14; ++symbolId)
+        {
+            std::memset(rows + symbolId * rowStride, 0, rowBytes);
+        }
+        const size_t minimum = EthernetPacket::HeaderSize + eCPRI_Packet::HeaderSize + EthernetPacket::FCSSize;
+        for (size_t p = begin; p < end; ++p)
+        {
+            const GridPacket& packet = packets[p];
+            size_t oranSize = sectionSize + static_cast<size_t>(packet.numPrb) * compression.PRBBytes();
+
+            // Every section is decoded in place from the capture
+            const CaptureReader::Frame& frame = capture.Frames()[packet.frame];
+            const uint8_t* oran = capture.FrameData(frame) + EthernetPacket::HeaderSize + eCPRI_Packet::HeaderSize;
+            size_t available = frame.length - minimum;
+            if (available < oranSize)
+            {
+                incomplete.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            uint8_t* row = rows + (packet.symbol - slot * 14) * rowStride + packet.startPrb * IQSampleStore::BytesPerPRB;
+            if (compression.Legacy())
+                std::memcpy(row, oran + sectionSize, packet.numPrb * IQSampleStore::BytesPerPRB);
+            else
+                compression.Decompress(oran + sectionSize, packet.numPrb, row);
+
+            if (reference.Enabled())
+                Compare(row, packet, reference, result);
+        }
+    }
+
+    // The section carried PRBs [startPrb, startPrb + numPrb) of its symbol (stream or generated payload), or with a
+    // fixed payload its part of the first ORAN.NRBperpacket PRBs of the file that every packet carries
+    void Compare(const uint8_t* row, const GridPacket& packet, const GridReference& reference, GridComparison& result) const
+    {
+        size_t bytes = packet.numPrb * IQSampleStore::BytesPerPRB;
+        uint8_t expected[1024 * IQSampleStore::BytesPerPRB];
+        if (reference.generator)
+            reference.generator->Generate(expected, static_cast<uint8_t>(stream), packet.symbol, packet.startPrb, packet.numPrb, prbs);
+        else if (reference.streamPayload)
+            reference.samples->PRBView(packet.symbol, packet.startPrb, packet.numPrb, prbs).CopyTo(expected, 0, bytes);
+        else
+            reference.samples->View(packet.startPrb % static_cast<int>(oran_nrbPerPacket) * IQSampleStore::BytesPerPRB, bytes)
+                .CopyTo(expected, 0, bytes);
+        for (size_t i = 0; i < bytes; i += 2)
+        {
+            int16_t decoded = static_cast<int16_t>(row[i] | row[i + 1] << 8);
+            int16_t original = static_cast<int16_t>(expected[i] | expected[i + 1] << 8);
+            double error = static_cast<double>(decoded) - original;
+            result.differentValues += decoded != original;
+            result.errorPower += error * error;
+            result.referencePower += static_cast<double>(original) * original;
+        }
+        result.values += bytes / 2;
+    }
+
+    CaptureReader& capture;
+    IQCompressor compression;
+    int prbs;
+    size_t rowBytes, rowStride, sectionSize;
+    int stream = -1;
+    std::vector<GridPacket> packets;
+    int64_t firstSlot = 0;
+    size_t slotCount = 0;
+    uint64_t malformed = 0;
+    std::atomic<uint64_t> incomplete{0};
+    GridComparison comparison;
+};
+
+int main(int argc, char* argv[])
+{
+    std::string setupFilePath = "SetupFile.txt";
+    std::string comparePath;
+    std::vector<std::string> paths;
+    unsigned threads = 0;
+    int eAxC = -1;
+    bool usage = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--setup" && i + 1 < argc)
+            setupFilePath = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = std::stoi(argv[++i]);
+        else if (arg == "--eaxc" && i + 1 < argc)
+            eAxC = std::stoi(argv[++i]);
+        else if (arg == "--compare" && i + 1 < argc)
+            comparePath = argv[++i];
+        else if (arg[0] != '-')
+            paths.push_back(arg);
+        else
+            usage = true;
+    }
+    if (usage || paths.size() != 2 || eAxC > 255)
+    {
+        std::cerr << "Usage: " << argv[0] << " [--setup SetupFile.txt] [--threads n] [--eaxc id] [--compare iq_file|generated] <capture> <grid.bin>"
+                  << std::endl;
+        return 1;
+    }
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    if (!readSetupFile(setupFilePath))
+    {
+        return 1;
+    }
+    if (output_ring_mb < 0)
+    {
+        std::cerr << "Invalid Output.RingSizeMB: " << output_ring_mb << " (expected 0 or more)" << std::endl;
+        return 1;
+    }
+    // Calculations() reports to the console
+    std::streambuf* console = cout.rdbuf(nullptr);
+    Calculations();
+    cout.rdbuf(console);
+
+    IQCompressor compression;
+    if (!IQCompressor::Parse(oran_compMethod, oran_iqWidth, compression))
+    {
+        std::cerr << "Unsupported IQ compression: " << oran_compMethod << " at " << oran_iqWidth << " bits" << std::endl;
+        return 1;
+    }
+    // --compare generated: regenerate the samples of a built-in ORAN.PayloadType
+    IQSampleStore referenceSamples;
+    IQPayloadGenerator generator;
+    GridReference reference;
+    reference.streamPayload = oran_payloadType != "fixed" && !oran_payloadType.empty();
+    if (comparePath == "generated")
+    {
+        if (oran_payloadType == "tone" && oran_tonePeriod < 1)
+        {
+            std::cerr << "Invalid ORAN.TonePeriod: " << oran_tonePeriod << " (expected 1 or more)" << std::endl;
+            return 1;
+        }
+        if (!IQPayloadGenerator::Parse(oran_payloadType, oran_payloadSeed, oran_tonePeriod, generator))
+        {
+            std::cerr << "ORAN.PayloadType " << oran_payloadType << " is not a generated payload" << std::endl;
+            return 1;
+        }
+        reference.generator = &generator;
+    }
+    else if (!comparePath.empty())
+    {
+        if (!referenceSamples.Open(comparePath))
+            return 1;
+        reference.samples = &referenceSamples;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    CaptureReader capture;
+    if (!capture.Open(paths[0], threads))
+    {
+        std::cerr << "Error opening capture " << paths[0] << std::endl;
+        return 1;
+    }
+
+    ResourceGridDecoder decoder(capture, compression);
+    decoder.Index(eAxC);
+    if (!capture.Error().empty())
+    {
+        std::cout << "Capture unreadable after frame " << capture.Frames().size() << ": " << capture.Error() << std::endl;
+    }
+    BufferedFileWriter output;
+    if (!output.Open(paths[1], static_cast<size_t>(output_ring_mb) << 20))
+    {
+        std::cerr << "Error opening output file." << std::endl;
+        return 1;
+    }
+    if (!decoder.Run(output, threads, reference))
+    {
+        output.Close();
+        std::cerr << "Error reading capture " << paths[0] << ": " << capture.Error() << std::endl;
+        return 1;
+    }
+    output.Close();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    cout << "Decoded " << decoder.Packets() << " ORAN packets of eAxC " << decoder.Stream() << " into " << decoder.Rows()
+         << " symbols x " << decoder.RowBytes() / IQSampleStore::BytesPerSample << " subcarriers ("
+         << decoder.Rows() * decoder.RowBytes() / 1e6 << " MB) in " << seconds << " s" << endl;
+    if (decoder.Malformed() + decoder.Incomplete() != 0)
+    {
+        cout << decoder.Malformed() << " malformed and " << decoder.Incomplete() << " incomplete sections left out" << endl;
+    }
+    if (!comparePath.empty())
+    {
+        const GridComparison& c = decoder.Comparison();
+        cout << "Compared with " << (reference.generator ? "the generated " + oran_payloadType + " payload" : comparePath) << ": "
+             << c.differentValues << " of " << c.values << " values differ";
+        if (c.differentValues == 0)
+            cout << " (bit-exact)";
+        else
+            cout << ", EVM " << 100 * std::sqrt(c.errorPower / std::max(c.referencePower, 1.0)) << " %";
+        cout << endl;
+        return c.differentValues == 0 ? 0 : 2;
+    }
+    return 0;
+}
@@ -0,0 +1,34 @@
+// Converts a text IQ file ("I Q" pairs) to the binary format read by ORAN.Payload=*.bin
+// (interleaved little-endian int16 I/Q samples)
+// Build: g++ -std=c++20 -O2 -pthread IQConvert.cpp -o IQConvert
+// Usage: IQConvert iq_file.txt iq_file.bin
+
+#define MILESTONE2_NO_MAIN
+#include "Milestone2.cpp"
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <input.txt> <output.bin>" << std::endl;
+        return 1;
+    }
+
+    IQSampleStore samples;
+    if (!samples.LoadText(argv[1]))
+    {
+        return 1;
+    }
+
+    BufferedFileWriter output;
+    if (!output.Open(argv[2]))
+    {
+        std::cerr << "Error opening output file." << std::endl;
+        return 1;
+    }
+    output.Write(samples.Data(), samples.Size());
+    output.Close();
+
+    std::cout << "Wrote " << samples.Size() << " bytes to " << argv[2] << std::endl;
+    return 0;
+}
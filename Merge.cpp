@@ -0,0 +1,136 @@
+// Joins the segment files of a sharded run (Gen.Shard=i/N) into one capture, identical to a single-process run
+// Build: g++ -std=c++20 -O2 -pthread Merge.cpp -o Merge
+// Usage: Merge output segment...
+//   segments are given in shard order (output.shard0, output.shard1, ...) and must be of the same format
+// Timestamps are absolute, so the segments are concatenated as they are: the file header (pcap) or the section and
+// interface blocks (pcapng) of the first segment are kept and dropped from the others, which must carry the same
+// Segments are read and copied window by window, so memory does not grow with them; compressed segments
+// (Output.Compression) are decompressed, and the merged capture is written uncompressed
+// The capture is written to output.partial and only renamed to output once every segment fitted, so a failed merge
+// leaves no output behind
+// Exit code 0 if the capture was written, 2 if the segments do not fit together, 1 if a file could not be read or written
+
+#define MILESTONE2_NO_MAIN
+#include "Milestone2.cpp"
+
+// Length of the header a segment shares with the others, after its first window: pcap file header, pcapng blocks
+// before the first packet
+static size_t SegmentHeaderLength(const CaptureReader& reader)
+{
+    if (reader.GetFormat() == CaptureReader::Text)
+        return 0;
+    if (reader.GetFormat() == CaptureReader::Pcap)
+        return 24;
+    // the first Enhanced Packet Block starts 28 bytes before its frame; without one the whole window is header
+    return reader.Frames().empty() ? reader.ChunkSize() : reader.Frames().front().offset - 28;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " output segment..." << std::endl;
+        return 1;
+    }
+    const std::string outputPath = argv[1];
+    std::vector<std::string> segments(argv + 2, argv + argc);
+
+    const std::string partialPath = outputPath + ".partial";
+    BufferedFileWriter output;
+    // the ring writes behind while the next segment is read
+    if (!output.Open(partialPath, 64 << 20))
+    {
+        std::cerr << "Error opening output file " << partialPath << std::endl;
+        return 1;
+    }
+    // drops what was written so far
+    auto fail = [&](int code)
+    {
+        output.Close();
+        std::remove(partialPath.c_str());
+        return code;
+    };
+
+    CaptureReader::Format format = CaptureReader::Text;
+    std::vector<uint8_t> header;
+    uint64_t lastTimestamp = 0, totalFrames = 0, totalBytes = 0;
+    for (size_t s = 0; s < segments.size(); ++s)
+    {
+        // read window by window: each is checked, then copied as it is
+        CaptureReader reader;
+        if (!reader.Open(segments[s], std::max(1u, std::thread::hardware_concurrency())))
+        {
+            std::cerr << "Error reading segment " << segments[s] << std::endl;
+            return fail(1);
+        }
+        if (s == 0)
+            format = reader.GetFormat();
+        auto mismatch = [&]()
+        {
+            std::cerr << segments[s] << ": not a segment of the same run as " << segments[0]
+                      << " (format or header differs)" << std::endl;
+            return fail(2);
+        };
+        bool started = false;
+        for (bool first = true; reader.NextWindow(); first = false)
+        {
+            const uint8_t* bytes = reader.ChunkBytes();
+            const size_t size = reader.ChunkSize();
+            const size_t headerLength = first ? SegmentHeaderLength(reader) : 0;
+            if (first && s == 0)
+            {
+                header.assign(bytes, bytes + headerLength);
+                output.Write(header.data(), header.size());
+            }
+            else if (first && (reader.GetFormat() != format || headerLength != header.size() ||
+                               !std::equal(header.begin(), header.end(), bytes)))
+                return mismatch();
+
+            const std::vector<CaptureReader::Frame>& frames = reader.Frames();
+            if (format != CaptureReader::Text && !started && !frames.empty())
+            {
+                started = true;
+                if (totalFrames != 0 && frames.front().timestampNs < lastTimestamp)
+                {
+                    std::cerr << segments[s] << ": starts at " << frames.front().timestampNs << " ns, before the end of "
+                              << segments[s - 1] << " (" << lastTimestamp << " ns); segments out of order or from different runs?"
+                              << std::endl;
+                    return fail(2);
+                }
+            }
+
+            output.Write(bytes + headerLength, size - headerLength);
+            totalBytes += size - headerLength;
+        }
+        if (!reader.Error().empty())
+        {
+            std::cerr << segments[s] << ": " << reader.Error() << std::endl;
+            return fail(2);
+        }
+        // a segment without a window (an empty file)
+        if (reader.GetFormat() != format)
+            return mismatch();
+
+        const std::vector<CaptureReader::Frame>& frames = reader.Frames();
+        if (format != CaptureReader::Text && !frames.empty())
+            lastTimestamp = frames.back().timestampNs;
+        totalFrames += frames.size();
+    }
+    output.Close();
+    if (output.Failed())
+    {
+        std::remove(partialPath.c_str());
+        return 1;
+    }
+    if (std::rename(partialPath.c_str(), outputPath.c_str()) != 0)
+    {
+        std::cerr << "Error renaming " << partialPath << " to " << outputPath << std::endl;
+        std::remove(partialPath.c_str());
+        return 1;
+    }
+
+    std::cout << "Merged " << segments.size() << " " << CaptureReader::FormatName(format) << " segments, "
+              << totalFrames << " frames, into " << outputPath << " (" << header.size() + totalBytes << " bytes)"
+              << std::endl;
+    return 0;
+}
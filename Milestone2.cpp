@@ -1,5 +1,6 @@
 #include <iostream>
 #include <cstdint>
+#include <cinttypes>
 #include <vector>
 #include <fstream>
 #include <string>
@@ -9,619 +10,5886 @@
 #include <cstring>
 #include <cmath>
 #include <utility> // for std::pair
+#include <array>
+#include <memory>
+#include <cstdio>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <climits>
+#include <charconv>
+#include <numeric>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <csignal>
+#include <span>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#if defined(MILESTONE2_WITH_ZSTD) && __has_include(<zstd.h>)
+#include <zstd.h>
+#define MILESTONE2_ZSTD 1
+#endif
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <cerrno>
+#endif
 
 using namespace std;
 
 // Declare Global variables to store the values in the setup file
     // Ethernet parameters:
-    int LineRate , CaptureSizeMs , MinNumOfIFGsPerPacket, MaxPacketSize , BurstSize, BurstPeriodicity;
+    int LineRate , MinNumOfIFGsPerPacket, MaxPacketSize , BurstSize, BurstPeriodicity;
+    int64_t CaptureSizeMs;  // 64-bit: multi-hour and multi-day captures
+    std::string eth_ifgFill = "frame"; // idle time filled with IFGs at the end of every symbol, slot or frame
     std::string Dest_Address , Source_Address;
 
-    // ECPRI parameters:
-    uint8_t eCPRI_Seqid = 0 ; // ranges from 0 to 255
+    // Generation parameters:
+    std::string gen_mode = "encode"; // encode (every frame built from scratch) or template (patch pre-encoded frames)
+    int gen_threads = 1;             // encoding threads, 0 = one per CPU
+    std::string gen_shard = "0/1";   // i/N: generate the i-th of N equal ranges of radio frames into a segment file
+    std::string gen_pipeline = "auto"; // auto (a compile-time specialized encoder when one matches the setup) or generic
+    int gen_continuous = 0;          // 1 = generate until SIGINT/SIGTERM instead of Eth.CaptureSizeMs
 
     //ORAN parameters:
     int oran_scs ;
     double oran_Maxprb , oran_nrbPerPacket;
-    const int MAX_ALLOWED_ORANPACKET_SIZE = 1466;
 
-    std::string oran_payloadType ,oran_payload;
+    std::string oran_payloadType ,oran_payload;  // ORAN.Payload may list one IQ file per eAxC, comma separated
+    uint64_t oran_payloadSeed = 1;         // seed of the random and QAM payload types
+    int oran_tonePeriod = 64;              // samples per cycle of the tone payload type
+    std::string oran_eAxC = "0";           // comma-separated eAxC IDs, one interleaved stream each
+    std::string oran_compMethod = "none";  // U-plane IQ compression: none (fixed point) or bfp (block floating point)
+    int oran_iqWidth = 16;                 // bits per I and per Q value: 8, 9, 12, 14 or 16
+
+    // Output parameters:
+    std::string output_format = "text" , output_file; // text (legacy hex dump), pcap, pcapng or live
+    std::string output_interface;    // network interface of Output.Format=live
+    int output_liveFcs = 0;          // 1 = send the FCS with each frame (NICs that do not append one)
+    int output_ring_mb = 32;         // output buffered for the writer thread, 0 = write from the generating thread
+    int output_segment_mb = 0;       // rotate the output file into segments of at most this size, 0 = no size cap
+    int output_segment_ms = 0;       // rotate the output file every this much capture time, 0 = no time cap
+    int output_segment_count = 0;    // segments kept on disk, the oldest deleted first; 0 = keep all
+    std::string output_compression = "none"; // none, lz4 or zstd: file output written as compressed, seekable blocks
+    int output_compression_level = 0;        // zstd level or LZ4 acceleration, 0 = default
+    int output_compression_threads = 0;      // compression threads, 0 = one per CPU
 
-    // Structure to hold IQ data
-    std::vector<std::pair<int, int> > iqData;
+    // Run statistics parameters:
+    std::string stats_file , stats_trace;  // JSON summary written at exit, Chrome trace of per-slot timings (empty = none)
+    int stats_progress_ms = 1000;          // minimum time between progress lines, 0 = no progress output
 
     // variables for calculations
-    int slots , No_of_Frames , No_of_Subframes , No_of_Slots , No_of_Symb , PacketsPerSymbol , No_of_packets , No_of_bits ,No_of_ifgs ;
+    int slots , PacketsPerSymbol , No_of_bits ,No_of_ifgs ;
+    int64_t No_of_Frames , No_of_Subframes , No_of_Slots , No_of_Symb , No_of_packets ;
     int Frame_duration = 10 ; // 10 ms
 
+// Settings of one run, built from a setup file or in code. Keys are the setup file keys; a setup file only sets the
+// keys it lists, the others keep the defaults below. Publish() copies the settings to the globals the stand-alone
+// generator and the companion tools read
+struct GeneratorConfig
+{
+    // Ethernet parameters:
+    int lineRate = 0, minIFGsPerPacket = 0, maxPacketSize = 0, burstSize = 0, burstPeriodicityUs = 0;
+    int64_t captureSizeMs = 0;
+    std::string ifgFill = "frame";
+    std::string destAddress, sourceAddress;
+
+    // ECPRI parameters:
+    uint8_t seqId = 0;
+
+    // Generation parameters:
+    std::string mode = "encode", shard = "0/1", pipeline = "auto";
+    int threads = 1;
+    int continuous = 0;
+
+    // ORAN parameters:
+    int scs = 0, maxNrb = 0, nrbPerPacket = 0;
+    std::string payloadType, payload;
+    uint64_t payloadSeed = 1;
+    int tonePeriod = 64;
+    std::string eAxC = "0";
+    std::string compMethod = "none";
+    int iqWidth = 16;
+    std::string directory;  // relative ORAN.Payload files are read from here: the setup file's directory, or the working directory
+
+    // Output and run statistics parameters:
+    std::string outputFormat = "text", outputFile, outputInterface;
+    int outputLiveFcs = 0, outputRingMb = 32;
+    int outputSegmentMb = 0, outputSegmentMs = 0, outputSegmentCount = 0;
+    std::string outputCompression = "none";
+    int outputCompressionLevel = 0, outputCompressionThreads = 0;
+    std::string statsFile, statsTrace;
+    int statsProgressMs = 1000;
+
+    // Set one key; false for an unknown key. Throws std::invalid_argument or std::out_of_range for a bad number
+    bool Set(const std::string& key, const std::string& value)
+    {
+        if (key == "Eth.LineRate")
+            lineRate = std::stoi(value);
+        else if (key == "Eth.CaptureSizeMs")
+            captureSizeMs = std::stoll(value);
+        else if (key == "Eth.MinNumOfIFGsPerPacket")
+            minIFGsPerPacket = std::stoi(value);
+        else if (key == "Eth.DestAddress")
+            destAddress = value;
+        else if (key == "Eth.SourceAddress")
+            sourceAddress = value;
+        else if (key == "Eth.MaxPacketSize")
+            maxPacketSize = std::stoi(value);
+        else if (key == "Eth.BurstSize")
+            burstSize = std::stoi(value);
+        else if (key == "Eth.BurstPeriodicity_us")
+            burstPeriodicityUs = std::stoi(value);
+        else if (key == "Eth.IFGFill")
+            ifgFill = value;
+        else if (key == "ECPRI.SeqId")
+            seqId = std::stoi(value);
+        else if (key == "ORAN.SCS")
+            scs = std::stoi(value);
+        else if (key == "ORAN.MaxNRB")
+            maxNrb = std::stoi(value);
+        else if (key == "ORAN.NRBperpacket")
+            nrbPerPacket = std::stoi(value);
+        else if (key == "ORAN.PayloadType")
+            payloadType = value;
+        else if (key == "ORAN.Payload")
+            payload = value;
+        else if (key == "ORAN.PayloadSeed")
+            payloadSeed = std::stoull(value);
+        else if (key == "ORAN.TonePeriod")
+            tonePeriod = std::stoi(value);
+        else if (key == "ORAN.eAxC")
+            eAxC = value;
+        else if (key == "ORAN.CompMethod")
+            compMethod = value;
+        else if (key == "ORAN.IQBitWidth")
+            iqWidth = std::stoi(value);
+        else if (key == "Gen.Mode")
+            mode = value;
+        else if (key == "Gen.Threads")
+            threads = std::stoi(value);
+        else if (key == "Gen.Shard")
+            shard = value;
+        else if (key == "Gen.Pipeline")
+            pipeline = value;
+        else if (key == "Gen.Continuous")
+            continuous = std::stoi(value);
+        else if (key == "Output.Format")
+            outputFormat = value;
+        else if (key == "Output.File")
+            outputFile = value;
+        else if (key == "Output.Interface")
+            outputInterface = value;
+        else if (key == "Output.LiveFCS")
+            outputLiveFcs = std::stoi(value);
+        else if (key == "Output.RingSizeMB")
+            outputRingMb = std::stoi(value);
+        else if (key == "Output.SegmentMB")
+            outputSegmentMb = std::stoi(value);
+        else if (key == "Output.SegmentMs")
+            outputSegmentMs = std::stoi(value);
+        else if (key == "Output.SegmentCount")
+            outputSegmentCount = std::stoi(value);
+        else if (key == "Output.Compression")
+            outputCompression = value;
+        else if (key == "Output.CompressionLevel")
+            outputCompressionLevel = std::stoi(value);
+        else if (key == "Output.CompressionThreads")
+            outputCompressionThreads = std::stoi(value);
+        else if (key == "Stats.File")
+            statsFile = value;
+        else if (key == "Stats.Trace")
+            statsTrace = value;
+        else if (key == "Stats.ProgressMs")
+            statsProgressMs = std::stoi(value);
+        else
+            return false;
+        return true;
+    }
+
+    // Read the key=value lines of a setup file; lines without a known key are ignored
+    bool Load(const std::string& setupFilePath)
+    {
+        std::ifstream SetupFile(setupFilePath);
+        if (!SetupFile)
+         {
+            std::cerr << "Error opening the Setup File." << std::endl;
+            return false;
+         }
+        size_t slash = setupFilePath.rfind('/');
+        directory = slash == std::string::npos ? "" : setupFilePath.substr(0, slash + 1);
+
+        std::string line;
+        while (std::getline(SetupFile, line))
+        {
+            std::istringstream obj(line);
+            std::string key, value;
+            if (std::getline(obj, key, '=') && std::getline(obj, value))
+            {
+                try {
+                    Set(key, value);
+                    }
+                 catch (const std::invalid_argument& e)
+                  {
+                    std::cerr << "Invalid value for " << key << ": " << value << std::endl;
+                    return false;
+                  }
+                 catch (const std::out_of_range& e)
+                  {
+                    std::cerr << "Value out of range for " << key << ": " << value << std::endl;
+                    return false;
+                  }
+           }
+        }
+        return true;
+    }
+
+    // ORAN.Payload as file paths, one per eAxC stream (the last one repeating for the remaining streams)
+    std::vector<std::string> PayloadFiles() const
+    {
+        std::vector<std::string> paths;
+        std::istringstream payloadList(payload.empty() ? "iq_file.txt" : payload);
+        for (std::string path; std::getline(payloadList, path, ',');)
+        {
+            if (!path.empty())
+                paths.push_back(path[0] == '/' ? path : directory + path);
+        }
+        if (paths.empty())
+            paths.push_back(directory + "iq_file.txt");
+        return paths;
+    }
+
+    void Publish() const;
+};
+
 // Function to read the setup file
 bool readSetupFile(const std::string& setupFilePath)
 {
-    std::ifstream SetupFile(setupFilePath);
-    if (!SetupFile)
-     {
-        std::cerr << "Error opening the Setup File." << std::endl;
+    GeneratorConfig config;
+    if (!config.Load(setupFilePath))
+    {
         return false;
-     }
-
-    std::string line;
-    while (std::getline(SetupFile, line))
-    {
-        std::istringstream obj(line);
-        std::string key, value;
-        if (std::getline(obj, key, '=') && std::getline(obj, value))
-        {
-            try {
-                if (key == "Eth.LineRate")
-                    LineRate = std::stoi(value);
-                else if (key == "Eth.CaptureSizeMs")
-                    CaptureSizeMs = std::stoi(value);
-                else if (key == "Eth.MinNumOfIFGsPerPacket")
-                    MinNumOfIFGsPerPacket = std::stoi(value);
-                else if (key == "Eth.DestAddress")
-                    Dest_Address = value;
-                else if (key == "Eth.SourceAddress")
-                    Source_Address = value;
-                else if (key == "Eth.MaxPacketSize")
-                    MaxPacketSize = std::stoi(value);
-                else if (key == "Eth.BurstSize")
-                    BurstSize = std::stoi(value);
-                else if (key == "ECPRI.SeqId")
-                    eCPRI_Seqid = std::stoi(value);
-                else if (key == "ORAN.SCS")
-                    oran_scs = std::stoi(value);
-                else if (key == "ORAN.MaxNRB")
-                    oran_Maxprb = std::stoi(value);
-                else if (key == "ORAN.NRBperpacket")
-                    oran_nrbPerPacket = std::stoi(value);
-                else if (key == "ORAN.PayloadType")
-                    oran_payloadType = value;
-                else if (key == "ORAN.Payload")
-                    oran_payload = value;
-                }
-             catch (const std::invalid_argument& e)
-              {
-                std::cerr << "Invalid value for " << key << ": " << value << std::endl;
-                return false;
-              }
-             catch (const std::out_of_range& e)
-              {
-                std::cerr << "Value out of range for " << key << ": " << value << std::endl;
-                return false;
-              }
-       }
     }
-    SetupFile.close();
+    config.Publish();
     return true;
 }
 
-
-// Function to read exactly 552 I/Q pairs (2208 bytes) for the ORAN payload, looping over the file if necessary
-std::vector<uint8_t> generateOranPayloadWithLooping(const std::string &filename)
+void GeneratorConfig::Publish() const
 {
-    std::vector<uint8_t> payload;
-    const size_t required_pairs = 552;
-    size_t pairs_read = 0;
-
-    while (pairs_read < required_pairs) {
-        std::ifstream iqFile(filename);
-        if (!iqFile.is_open()) {
-            std::cerr << "Error: Unable to open the IQ file." << std::endl;
-            return {};
-        }
+    LineRate = lineRate;
+    CaptureSizeMs = captureSizeMs;
+    MinNumOfIFGsPerPacket = minIFGsPerPacket;
+    MaxPacketSize = maxPacketSize;
+    BurstSize = burstSize;
+    BurstPeriodicity = burstPeriodicityUs;
+    eth_ifgFill = ifgFill;
+    Dest_Address = destAddress;
+    Source_Address = sourceAddress;
+    gen_mode = mode;
+    gen_threads = threads;
+    gen_shard = shard;
+    gen_pipeline = pipeline;
+    gen_continuous = continuous;
+    oran_scs = scs;
+    oran_Maxprb = maxNrb;
+    oran_nrbPerPacket = nrbPerPacket;
+    oran_payloadType = payloadType;
+    oran_payload = payload;
+    oran_payloadSeed = payloadSeed;
+    oran_tonePeriod = tonePeriod;
+    oran_eAxC = eAxC;
+    oran_compMethod = compMethod;
+    oran_iqWidth = iqWidth;
+    output_format = outputFormat;
+    output_file = outputFile;
+    output_interface = outputInterface;
+    output_liveFcs = outputLiveFcs;
+    output_ring_mb = outputRingMb;
+    output_segment_mb = outputSegmentMb;
+    output_segment_ms = outputSegmentMs;
+    output_segment_count = outputSegmentCount;
+    output_compression = outputCompression;
+    output_compression_level = outputCompressionLevel;
+    output_compression_threads = outputCompressionThreads;
+    stats_file = statsFile;
+    stats_trace = statsTrace;
+    stats_progress_ms = statsProgressMs;
+}
 
-        int32_t i_value, q_value;
-        // Read I/Q values until we reach the end of the file or gather the required pairs
-        while (pairs_read < required_pairs && (iqFile >> i_value >> q_value)) {
-            // Convert to 16-bit signed integers
-            int16_t i_converted = static_cast<int16_t>(i_value);
-            int16_t q_converted = static_cast<int16_t>(q_value);
 
-            // Append I and Q in little-endian format
-            payload.push_back(static_cast<uint8_t>(i_converted & 0xFF));
-            payload.push_back(static_cast<uint8_t>((i_converted >> 8) & 0xFF));
-            payload.push_back(static_cast<uint8_t>(q_converted & 0xFF));
-            payload.push_back(static_cast<uint8_t>((q_converted >> 8) & 0xFF));
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile() : mapped(nullptr), size(0) {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { Close(); }
 
-            pairs_read++;
+    bool Open(const std::string& path)
+    {
+        Close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        size = static_cast<size_t>(info.st_size);
+        if (size > 0)
+        {
+            mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED)
+            {
+                mapped = nullptr;
+                ::close(fd);
+                return false;
+            }
+            madvise(mapped, size, MADV_SEQUENTIAL);
         }
-        iqFile.close();
+        ::close(fd);
+        return true;
+    }
 
-        // If we reached the end of the file without gathering enough pairs, restart the loop to read from the beginning again
-        if (pairs_read < required_pairs) {
-            std::cout << "Reached end of IQ file. Restarting to gather more samples..." << std::endl;
+    void Close()
+    {
+        if (mapped)
+        {
+            munmap(mapped, size);
         }
+        mapped = nullptr;
+        size = 0;
     }
 
-    return payload;
-}
+    const uint8_t* Data() const { return static_cast<const uint8_t*>(mapped); }
+    size_t Size() const { return size; }
 
+private:
+    void* mapped;
+    size_t size;
+};
 
-// Helper function to convert string MAC address to uint64_t
-uint64_t macAddressToUInt64(const std::string& mac)
+// Fast loader for text IQ files: the file is split into chunks at line boundaries, each chunk is parsed by its own
+// thread with std::from_chars and narrowed to int16 with SIMD. The result is identical to reading the file with
+// `iqFile >> i_value >> q_value` and static_cast<int16_t>: parsing stops at the first token operator>> rejects,
+// values keep their low 16 bits and a trailing unpaired value is dropped
+class IQTextParser
 {
-    uint64_t macAddress = 0;
-    std::istringstream iss(mac);
-    std::string byteStr;
-    while (std::getline(iss, byteStr, ':')) {
-        macAddress = (macAddress << 8) + std::stoul(byteStr, nullptr, 16);
+public:
+    // Parse `size` bytes of text into little-endian int16 I/Q samples
+    static std::vector<uint8_t> Parse(const char* text, size_t size, unsigned threads)
+    {
+        const size_t minChunk = 4 << 20;
+        size_t chunks = std::max<size_t>(1, std::min<size_t>(threads, size / minChunk));
+
+        // Chunk boundaries just after a newline so that no token is split
+        std::vector<const char*> bounds(1, text);
+        for (size_t c = 1; c < chunks; ++c)
+        {
+            const char* cut = text + size * c / chunks;
+            cut = std::max(cut, bounds.back());
+            const char* newline = static_cast<const char*>(std::memchr(cut, '\n', text + size - cut));
+            bounds.push_back(newline ? newline + 1 : text + size);
+        }
+        bounds.push_back(text + size);
+
+        std::vector<std::vector<uint8_t>> parts(chunks);
+        std::vector<char> complete(chunks);
+        std::vector<std::thread> workers;
+        for (size_t c = 0; c < chunks; ++c)
+        {
+            auto work = [&, c]() { complete[c] = ParseChunk(bounds[c], bounds[c + 1], parts[c]); };
+            if (c + 1 < chunks)
+                workers.emplace_back(work);
+            else
+                work();
+        }
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+
+        // Everything after the first rejected token is ignored, like the stream loop would
+        size_t total = 0;
+        size_t used = 0;
+        while (used < chunks)
+        {
+            total += parts[used].size();
+            if (!complete[used++])
+                break;
+        }
+        std::vector<uint8_t> samples;
+        samples.reserve(total);
+        for (size_t c = 0; c < used; ++c)
+        {
+            samples.insert(samples.end(), parts[c].begin(), parts[c].end());
+        }
+        samples.resize(samples.size() - samples.size() % 4);  // whole I/Q pairs only
+        return samples;
     }
-    return macAddress;
-}
 
-class EthernetPacket {
-public:
-    static const uint64_t PreambleAndSFD = 0xFB555555555555D5; // 8 bytes (64 bits)
-    uint64_t DestAddress;  // 6 bytes (48 bits)
-    uint64_t SourceAddress; // 6 bytes (48 bits)
-    static const uint16_t EtherType = 0xAEFE;  // 2 bytes (16 bits), eCPRI Protocol
-    std::vector<uint8_t> Payload;  // varies from 46 to 1474 bytes
-    uint32_t FCS;  // 4 bytes (32 bits)
-    const int MaxPayloadSize = 1474;
-    const int MinPayloadSize = 46;
+    // Keep the low 16 bits of each value and store them little-endian, 2 bytes per value
+    static void NarrowToInt16(const int32_t* values, size_t count, uint8_t* out)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        static const bool avx2 = __builtin_cpu_supports("avx2");
+        static const bool sse41 = __builtin_cpu_supports("sse4.1");
+        if (avx2)
+            return NarrowAVX2(values, count, out);
+        if (sse41)
+            return NarrowSSE41(values, count, out);
+#endif
+        NarrowScalar(values, count, out);
+    }
 
-    // Generate the payload with the size ensuring it's within valid bounds
-    void GeneratePayload(size_t PayloadSize)
+    static void NarrowScalar(const int32_t* values, size_t count, uint8_t* out)
     {
-        if (PayloadSize < MinPayloadSize)
+        for (size_t i = 0; i < count; ++i)
         {
-            PayloadSize = MinPayloadSize; // Payload = 46 bytes
+            int16_t converted = static_cast<int16_t>(values[i]);
+            out[2 * i] = static_cast<uint8_t>(converted & 0xFF);
+            out[2 * i + 1] = static_cast<uint8_t>((converted >> 8) & 0xFF);
         }
-        else if (PayloadSize > MaxPayloadSize)
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    // Masking to 16 bits first turns the unsigned saturating pack into a plain truncation
+    __attribute__((target("sse4.1")))
+    static void NarrowSSE41(const int32_t* values, size_t count, uint8_t* out)
+    {
+        const __m128i mask = _mm_set1_epi32(0xFFFF);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
         {
-            PayloadSize = MaxPayloadSize; // Payload = 1474 bytes
+            __m128i low = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i)), mask);
+            __m128i high = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i + 4)), mask);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_packus_epi32(low, high));
+        }
+        NarrowScalar(values + i, count - i, out + 2 * i);
+    }
+
+    __attribute__((target("avx2")))
+    static void NarrowAVX2(const int32_t* values, size_t count, uint8_t* out)
+    {
+        const __m256i mask = _mm256_set1_epi32(0xFFFF);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m256i low = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i)), mask);
+            __m256i high = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i + 8)), mask);
+            // packus works per 128-bit lane, put the 64-bit quarters back in order
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(low, high), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i), packed);
         }
+        NarrowScalar(values + i, count - i, out + 2 * i);
+    }
+#endif
 
+private:
+    static bool IsSpace(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
     }
 
-    // Compute CRC32 for the given frame (without FCS)
-    uint32_t ComputeCRC32(const std::vector<uint8_t>& frame) {
-        uint32_t crc = 0xFFFFFFFF;
-        for (uint8_t byte : frame) {
-            crc ^= (uint32_t)byte;
-            for (int i = 0; i < 8; ++i) {
-                if (crc & 1)
-                    crc = (crc >> 1) ^ 0x04C11DB7;
-                else
-                    crc >>= 1;
+    // Parse one chunk into int16 bytes, returns false if it stopped on a token operator>> would reject
+    static bool ParseChunk(const char* p, const char* end, std::vector<uint8_t>& out)
+    {
+        std::vector<int32_t> values;
+        values.reserve((end - p) / 4);
+        bool complete = true;
+        while (true)
+        {
+            while (p < end && IsSpace(*p))
+                ++p;
+            if (p == end)
+                break;
+            const char* start = (*p == '+' && p + 1 < end && *(p + 1) != '-') ? p + 1 : p;
+            int32_t value;
+            std::from_chars_result result = std::from_chars(start, end, value);
+            if (result.ec != std::errc())
+            {
+                complete = false;  // not a number or out of int32 range
+                break;
             }
+            values.push_back(value);
+            p = result.ptr;
         }
-        return ~crc;  // Finalize the CRC by inverting all bits
+        out.resize(values.size() * 2);
+        NarrowToInt16(values.data(), values.size(), out.data());
+        return complete;
     }
+};
 
-   // Function to generate the full Ethernet packets
-    std::vector<uint8_t> GenerateEthernetPackets(const std::vector<uint8_t>& etherpayload) // pass the ecpri packet as an argument
+// Read-only window over IQ sample bytes that wraps around the end of the underlying buffer
+struct IQView
+{
+    const uint8_t* base;  // start of the sample buffer
+    size_t baseSize;      // size of the sample buffer in bytes
+    size_t offset;        // first byte of the view inside the buffer
+    size_t length;        // bytes in the view
+
+    static IQView Contiguous(const uint8_t* data, size_t size)
     {
-          std::vector<uint8_t> Packet;
+        IQView view = { data, size, 0, size };
+        return view;
+    }
 
-          // 1. Add Preamble and SFD (8 bytes)
-          uint64_t preambleandSFD = PreambleAndSFD;
-          for (int i = 7; i >= 0; --i)
+    // Copy bytes [from, from + count) of the view to dst
+    void CopyTo(uint8_t* dst, size_t from, size_t count) const
+    {
+        size_t position = (offset + from) % baseSize;
+        while (count > 0)
+        {
+            size_t chunk = std::min(count, baseSize - position);
+            std::memcpy(dst, base + position, chunk);
+            dst += chunk;
+            count -= chunk;
+            position = 0;
+        }
+    }
+};
+
+// O-RAN U-plane IQ compression, signalled by udCompHdr (udIqWidth, udCompMeth) in the section header
+// Fixed point keeps the `width` most significant bits of every I and Q value. Block floating point stores one
+// udCompParam byte per PRB holding a shared exponent e, followed by the 24 values (value >> e) in `width` bits.
+// Compressed values are packed MSB first, 3 * width bytes per PRB. Fixed point at 16 bits is the uncompressed
+// payload of earlier versions: samples are copied as they are (little-endian) and there is no udCompHdr
+class IQCompressor
+{
+public:
+    enum Method { FixedPoint = 0, BlockFloatingPoint = 1 };
+
+    static const int ValuesPerPRB = 24;  // 12 samples, I and Q
+
+    IQCompressor() : method(FixedPoint), width(16) {}
+
+    // ORAN.CompMethod / ORAN.IQBitWidth; false if the combination is not supported
+    static bool Parse(const std::string& methodName, int width, IQCompressor& compressor)
+    {
+        if (width != 8 && width != 9 && width != 12 && width != 14 && width != 16)
+            return false;
+        if (methodName == "none")
+            compressor.method = FixedPoint;
+        else if (methodName == "bfp")
+            compressor.method = BlockFloatingPoint;
+        else
+            return false;
+        compressor.width = width;
+        return true;
+    }
+
+    Method GetMethod() const { return method; }
+    int Width() const { return width; }
+
+    // Uncompressed 16-bit payload without udCompHdr
+    bool Legacy() const { return method == FixedPoint && width == 16; }
+
+    // udIqWidth in the high nibble (0 means 16 bits), udCompMeth in the low nibble
+    uint8_t UdCompHdr() const { return static_cast<uint8_t>(((width & 0x0F) << 4) | method); }
+
+    size_t PRBBytes() const { return (method == BlockFloatingPoint ? 1 : 0) + 3 * width; }
+
+    // Compress `prbs` PRBs of little-endian int16 I/Q samples (48 bytes each) to PRBBytes() bytes each
+    void Compress(const uint8_t* in, size_t prbs, uint8_t* out) const
+    {
+        int16_t values[ValuesPerPRB];
+        for (size_t prb = 0; prb < prbs; ++prb, in += ValuesPerPRB * 2)
+        {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            std::memcpy(values, in, sizeof(values));
+#else
+            for (int i = 0; i < ValuesPerPRB; ++i)
             {
-              Packet.push_back((preambleandSFD >> (i * 8)) & 0xFF); //shift right by i bytes
+                values[i] = static_cast<int16_t>(in[2 * i] | (in[2 * i + 1] << 8));
             }
-
-          // 2. Add Destination MAC Address (6 bytes)
-          for (int i = 5; i >= 0; --i)
+#endif
+            int shift = 16 - width;
+            if (method == BlockFloatingPoint)
             {
-              Packet.push_back((DestAddress >> (i * 8)) & 0xFF);
+                shift = Exponent(Magnitude(values));
+                *out++ = static_cast<uint8_t>(shift);  // udCompParam: 4 reserved bits, 4-bit exponent
             }
+            out = Pack(values, shift, out);
+        }
+    }
 
-          // 3. Add Source MAC Address (6 bytes)
-          for (int i = 5; i >= 0; --i)
+    // Inverse of Compress: `prbs` PRBs of PRBBytes() bytes back to little-endian int16 I/Q samples (48 bytes each)
+    // Each value is shifted back left by its exponent (bfp) or by 16 - width (fixed point); the bits dropped stay zero
+    void Decompress(const uint8_t* in, size_t prbs, uint8_t* out) const
+    {
+        int16_t values[ValuesPerPRB];
+        for (size_t prb = 0; prb < prbs; ++prb, out += ValuesPerPRB * 2)
+        {
+            int shift = 16 - width;
+            if (method == BlockFloatingPoint)
             {
-              Packet.push_back((SourceAddress >> (i * 8)) & 0xFF);
+                shift = *in++ & 0x0F;
             }
-
-          // 4. Add EtherType (2 bytes)
-          uint16_t etherType = EtherType;
-          for (int i = 1; i >= 0; --i)
+            switch (width)
             {
-              Packet.push_back((etherType >> (i * 8)) & 0xFF);
+            case 8: in = UnpackGroups<8>(in, shift, values); break;
+            case 9: in = UnpackGroups<9>(in, shift, values); break;
+            case 12: in = UnpackGroups<12>(in, shift, values); break;
+            case 14: in = UnpackGroups<14>(in, shift, values); break;
+            default: in = UnpackGroups<16>(in, shift, values); break;
             }
-
-          // 5. Add Payload
-          // check on payload if it needs fragmentation
-          Packet.insert(Packet.end(),etherpayload.begin(),etherpayload.end());
-
-          // 6. Compute FCS (without including the FCS itself in the frame)
-          FCS = ComputeCRC32(Packet);
-
-          // 7. Add FCS (4 bytes)
-          for (int i = 3; i >= 0; --i)
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            std::memcpy(out, values, sizeof(values));
+#else
+            for (int i = 0; i < ValuesPerPRB; ++i)
             {
-              Packet.push_back((FCS >> (i * 8)) & 0xFF);
+                out[2 * i] = static_cast<uint8_t>(values[i] & 0xFF);
+                out[2 * i + 1] = static_cast<uint8_t>((values[i] >> 8) & 0xFF);
             }
+#endif
+        }
+    }
 
-    return Packet;
-   }
-
-    // Add Inter-Frame Gap (IFG)
-    void AddIFG(std::vector<uint8_t>& Packet)
+    // Smallest exponent that fits every value with the given magnitude bound into `width` bits, two's complement
+    int Exponent(int magnitude) const
     {
-        const uint8_t IFG = 0x07 ;
-        while (Packet.size() % 4 != 0)
-         {
-            Packet.push_back(IFG);  // Add one-byte IFG (0x07) to make it 4-byte aligned
-         }
+        int bits = magnitude == 0 ? 0 : 32 - __builtin_clz(magnitude);
+        return std::max(0, bits + 1 - width);
     }
-};
-
-class eCPRI_Packet : public EthernetPacket
-{
-    public:
-    const uint8_t eCPRI_Version = 0x00 ; // first byte is zero dummies
-    const uint8_t eCPRI_Message = 0x00 ; // user plane (indicates the type of service conveyed by the message type)
-    size_t eCPRI_Payload ; // indicates the size in bytes of the payload part , Max supported payload = 65535 bits = 8191.875 bytes
-    const double MaxSupprotedPayload = 8191.875;
-    const uint8_t eCPRI_PC_RTC = 0x00 ;  // fixed
 
-    // default constructor
-    eCPRI_Packet ()
+    // Largest of v (v >= 0) and ~v (v < 0) over the PRB: v fits w bits after >> e iff this is below 2^(w-1+e)
+    static int Magnitude(const int16_t* values)
     {
-
+#if defined(__SSE2__)
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + 8));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + 16));
+        a = _mm_xor_si128(a, _mm_srai_epi16(a, 15));
+        b = _mm_xor_si128(b, _mm_srai_epi16(b, 15));
+        c = _mm_xor_si128(c, _mm_srai_epi16(c, 15));
+        __m128i m = _mm_max_epi16(_mm_max_epi16(a, b), c);
+        m = _mm_max_epi16(m, _mm_shuffle_epi32(m, 0x4E));
+        m = _mm_max_epi16(m, _mm_shuffle_epi32(m, 0xB1));
+        m = _mm_max_epi16(m, _mm_shufflelo_epi16(m, 0xB1));
+        return _mm_extract_epi16(m, 0);
+#else
+        int magnitude = 0;
+        for (int i = 0; i < ValuesPerPRB; ++i)
+        {
+            int v = values[i];
+            magnitude = std::max(magnitude, v < 0 ? ~v : v);
+        }
+        return magnitude;
+#endif
     }
 
-    // function to generate ECPRI packet
-    std::vector<uint8_t> GenerateECPRIPacket (const std::vector<uint8_t>& oranPacket) // takes oran packet as an argument to be its payload
+private:
+    // Shift the 24 values right and pack them MSB first in `width` bits each
+    uint8_t* Pack(const int16_t* values, int shift, uint8_t* out) const
     {
-        std::vector<uint8_t> eCPRIPacket;
-
-        // 1. Add first byte
-           eCPRIPacket.push_back(eCPRI_Version);
+#if defined(__SSE2__)
+        __m128i count = _mm_cvtsi32_si128(shift);
+        __m128i a = _mm_sra_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values)), count);
+        __m128i b = _mm_sra_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + 8)), count);
+        __m128i c = _mm_sra_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values + 16)), count);
+        if (width == 8)
+        {
+            // the values already fit a signed byte, saturation never applies
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packs_epi16(a, b));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 16), _mm_packs_epi16(c, c));
+            return out + 24;
+        }
+        if (width == 16)
+        {
+            // big-endian 16-bit values: swap the bytes of every lane
+            a = _mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8));
+            b = _mm_or_si128(_mm_slli_epi16(b, 8), _mm_srli_epi16(b, 8));
+            c = _mm_or_si128(_mm_slli_epi16(c, 8), _mm_srli_epi16(c, 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), a);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), b);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 32), c);
+            return out + 48;
+        }
+        int16_t shifted[ValuesPerPRB];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(shifted), a);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(shifted + 8), b);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(shifted + 16), c);
+        return PackBits(shifted, 0, out);
+#else
+        return PackBits(values, shift, out);
+#endif
+    }
 
-        // 2. Add ecpriMessage
-           eCPRIPacket.push_back(eCPRI_Message);
+    uint8_t* PackBits(const int16_t* values, int shift, uint8_t* out) const
+    {
+        switch (width)
+        {
+        case 8: return PackGroups<8>(values, shift, out);
+        case 9: return PackGroups<9>(values, shift, out);
+        case 12: return PackGroups<12>(values, shift, out);
+        case 14: return PackGroups<14>(values, shift, out);
+        default: return PackGroups<16>(values, shift, out);
+        }
+    }
 
-        // 3. Add ecpriPayload
-            size_t eCPRI_Payload = oranPacket.size();
-            if (eCPRI_Payload > MaxSupprotedPayload)
+    // 64-bit bit accumulator flushed 32 bits at a time; with the width known at compile time the loop unrolls and
+    // every flush position is fixed
+    template <int Width>
+    static uint8_t* PackGroups(const int16_t* values, int shift, uint8_t* out)
+    {
+        const uint32_t mask = (1u << Width) - 1;
+        uint64_t accumulator = 0;
+        int bits = 0;
+#pragma GCC unroll 24
+        for (int i = 0; i < ValuesPerPRB; ++i)
+        {
+            accumulator = (accumulator << Width) | (static_cast<uint32_t>(values[i] >> shift) & mask);
+            bits += Width;
+            if (bits >= 32)
             {
-                cerr << "Packet size is not valid , increase maxPacketSize or decrease the NRBs used." << endl;
+                bits -= 32;
+                uint32_t word = __builtin_bswap32(static_cast<uint32_t>(accumulator >> bits));
+                std::memcpy(out, &word, 4);
+                out += 4;
             }
-            else
+        }
+        for (; bits > 0; bits -= 8)
+        {
+            *out++ = static_cast<uint8_t>(accumulator >> (bits - 8));  // 24 * Width bits end on a byte boundary
+        }
+        return out;
+    }
+
+    // Read 24 values of Width bits MSB first, sign-extend them and shift them back left
+    template <int Width>
+    static const uint8_t* UnpackGroups(const uint8_t* in, int shift, int16_t* values)
+    {
+        const uint32_t mask = (1u << Width) - 1;
+        uint64_t accumulator = 0;
+        int bits = 0;
+#pragma GCC unroll 24
+        for (int i = 0; i < ValuesPerPRB; ++i)
+        {
+            while (bits < Width)
             {
-                eCPRIPacket.push_back(static_cast<uint8_t>(eCPRI_Payload >> 8));  // Higher byte of the size
-                eCPRIPacket.push_back(static_cast<uint8_t>(eCPRI_Payload & 0xFF)); // Lower byte of the size
+                accumulator = (accumulator << 8) | *in++;
+                bits += 8;
             }
+            bits -= Width;
+            uint32_t raw = static_cast<uint32_t>(accumulator >> bits) & mask;
+            int32_t value = static_cast<int32_t>(raw << (32 - Width)) >> (32 - Width);
+            values[i] = static_cast<int16_t>(static_cast<uint32_t>(value) << shift);
+        }
+        return in;
+    }
 
-        // 4. Add ecpriPC/RTC
-           eCPRIPacket.push_back(eCPRI_PC_RTC);
+    Method method;
+    int width;
+};
 
-        // 5. Add ecpriSeqid
-           eCPRIPacket.push_back(eCPRI_Seqid);
+// IQ samples for the ORAN payloads: 16-bit I then 16-bit Q, little-endian, 12 samples per PRB
+// Binary files (.bin) are memory-mapped once, text files are parsed once; packets then address the samples
+// by symbol and PRB and read them through an IQView, wrapping at the end of the file
+class IQSampleStore
+{
+public:
+    static const size_t BytesPerSample = 4;
+    static const size_t BytesPerPRB = 12 * BytesPerSample;
 
-        // 6. Add ORAN packet as ecpri payload
-           eCPRIPacket.insert(eCPRIPacket.end(), oranPacket.begin(), oranPacket.end());
+    IQSampleStore() : data(nullptr), size(0), prbBytes(BytesPerPRB) {}
+    IQSampleStore(const IQSampleStore&) = delete;
+    IQSampleStore& operator=(const IQSampleStore&) = delete;
 
-       return eCPRIPacket;
+    // Load a .bin file as binary samples, anything else as "I Q" text pairs
+    bool Open(const std::string& path)
+    {
+        if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".bin") == 0)
+            return OpenBinary(path);
+        return LoadText(path);
     }
 
+    // Map a file of interleaved little-endian int16 I/Q samples
+    bool OpenBinary(const std::string& path)
+    {
+        if (!file.Open(path))
+        {
+            std::cerr << "Error: Unable to open the IQ file." << std::endl;
+            return false;
+        }
+        data = file.Data();
+        size = file.Size() - file.Size() % BytesPerSample;  // ignore a trailing partial sample
+        if (size == 0)
+        {
+            std::cerr << "Error: IQ file " << path << " holds no samples." << std::endl;
+            return false;
+        }
+        return true;
+    }
 
-};
+    // Parse a text file of "I Q" pairs with IQTextParser, narrowing each value to int16 (its low 16 bits, as a
+    // static_cast does)
+    bool LoadText(const std::string& path)
+    {
+        MappedFile text;
+        if (!text.Open(path))
+        {
+            std::cerr << "Error: Unable to open the IQ file." << std::endl;
+            return false;
+        }
+        auto start = std::chrono::steady_clock::now();
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        samples = IQTextParser::Parse(reinterpret_cast<const char*>(text.Data()), text.Size(), threads);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (samples.empty())
+        {
+            std::cerr << "Error: IQ file " << path << " holds no samples." << std::endl;
+            return false;
+        }
+        std::cout << "Loaded " << samples.size() / BytesPerSample << " IQ samples from " << text.Size() / 1e6 << " MB of text in "
+                  << seconds * 1e3 << " ms (" << text.Size() / 1e6 / std::max(seconds, 1e-9) << " MB/s)" << std::endl;
+        data = samples.data();
+        size = samples.size();
+        return true;
+    }
 
-class ORAN_Packet : public eCPRI_Packet
-{
-    public:
-    const uint8_t ORAN_FirstByte = 0x00 ;  // includes dataDirection , payloadVersion and filterIndex
-    const uint16_t SectionID = 0x000 ;
-    unsigned rb : 1 ; // 1 bit field for rb
-    unsigned symInc : 1 ;  // 1 bit field for symInc
-    uint8_t FrameID , SubframeID , SlotID , SymbolID ;
-    uint8_t numPrbu = oran_nrbPerPacket; // numPrbu field : number of contiguous PRBs per data section
-    uint16_t startPrbu; //used to indicate the starting Physical Resource Block (PRB) unit within a specific data section
-    std::vector<uint8_t> oranPayload;
-    // Constructor to initialize fields
-    ORAN_Packet()
-        : rb(0), symInc(0), FrameID(0), SubframeID(0), SlotID(0), SymbolID(0), startPrbu(0)
-    {}
-
-    // function to generate full ORAN packet
-    std::vector<uint8_t> GenerateORANPacket(const std::vector<uint8_t>& payload, uint16_t startPrbu)
+    // Use samples already in memory, truncated to whole samples
+    void Assign(std::vector<uint8_t> bytes)
     {
-       std::vector<uint8_t> ORANPacket;
-
-          // 1. Add the first byte (dataDirection, payloadVersion, and filterIndex combined)
-             ORANPacket.push_back(ORAN_FirstByte);
-
-          // 2. Add FrameId
-             ORANPacket.push_back(FrameID);
+        samples = std::move(bytes);
+        samples.resize(samples.size() - samples.size() % BytesPerSample);
+        data = samples.data();
+        size = samples.size();
+    }
 
-          // 3. Combine SubframeID (4 bits) with the first 4 bits of SlotID to make 1 byte
-             uint8_t combinedHeader1 = (SubframeID << 4) | ((SlotID >> 2) & 0x0F);
-             ORANPacket.push_back(combinedHeader1);
+    size_t Size() const { return size; }
 
-          // 4. Combine the remaining 2 bits of SlotID with SymbolID (6 bits) to make 1 byte
-             uint8_t combinedHeader2 = ((SlotID & 0x03) << 6) | (SymbolID & 0x3F);
-             ORANPacket.push_back(combinedHeader2);
+    const uint8_t* Data() const { return data; }
 
-          // 5. Add first 8 bits of the SectionID
-             ORANPacket.push_back(static_cast<uint8_t>((SectionID >> 4) & 0xFF));
+    // Bytes of one PRB in the payload, smaller than BytesPerPRB once compressed
+    size_t PRBBytes() const { return prbBytes; }
 
-          // 6. Combine the remaining 4 bits of SectionID with rb, symInc, and the first 2 bits of startPrbu
-             uint8_t combinedField = ((SectionID & 0x0F) << 4) | ((rb << 3) | (symInc << 2) | ((startPrbu >> 8) & 0x03));
-             ORANPacket.push_back(combinedField);
+    // Compress the samples PRB by PRB once, so packets copy compressed PRBs like uncompressed ones
+    // PRB k holds the stream bytes [48 k, 48 k + 48), wrapping at the end of the samples; the compressed stream
+    // covers one period of that sequence (size / gcd(size, 48) PRBs) so it wraps at the same place
+    bool Compress(const IQCompressor& compressor)
+    {
+        if (compressor.Legacy())
+            return true;
+        const size_t maxCompressedBytes = 1ull << 30;
+        size_t prbs = size / std::gcd(size, BytesPerPRB);
+        if (prbs * compressor.PRBBytes() > maxCompressedBytes)
+        {
+            prbs = std::max<size_t>(1, size / BytesPerPRB);
+            std::cout << "IQ file is not a whole number of PRBs, the last partial PRB is not used when compressing." << std::endl;
+        }
 
-          // 7. Add the remaining 8 bits of startPrbu
-             ORANPacket.push_back(static_cast<uint8_t>(startPrbu & 0xFF));
+        std::vector<uint8_t> compressed(prbs * compressor.PRBBytes());
+        uint8_t raw[BytesPerPRB * 64];
+        for (size_t prb = 0; prb < prbs; prb += 64)
+        {
+            size_t count = std::min<size_t>(64, prbs - prb);
+            View(prb * BytesPerPRB, count * BytesPerPRB).CopyTo(raw, 0, count * BytesPerPRB);
+            compressor.Compress(raw, count, compressed.data() + prb * compressor.PRBBytes());
+        }
 
-          // 8. Add numPrbu (1 byte)
-             ORANPacket.push_back(numPrbu);
+        samples = std::move(compressed);
+        data = samples.data();
+        size = samples.size();
+        prbBytes = compressor.PRBBytes();
+        return true;
+    }
 
-          // 9. Add Payload
-             oranPayload = payload;
-             ORANPacket.insert(ORANPacket.end(), oranPayload.begin(), oranPayload.end());
+    // `length` bytes starting at byte `offset` of the sample stream
+    IQView View(uint64_t offset, size_t length) const
+    {
+        IQView view = { data, size, static_cast<size_t>(offset % size), length };
+        return view;
+    }
 
-      return ORANPacket;
-   }
+    // Samples of PRBs [prb, prb + numPrb) of a symbol; symbols follow each other in the file, prbsPerSymbol PRBs each
+    IQView PRBView(uint64_t symbolIndex, uint32_t prb, uint32_t numPrb, uint32_t prbsPerSymbol) const
+    {
+        return View((symbolIndex * prbsPerSymbol + prb) * prbBytes, numPrb * prbBytes);
+    }
 
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t prbBytes;
+    std::vector<uint8_t> samples;  // text input or compressed PRBs
+    MappedFile file;               // binary input
 };
 
-std::vector<ORAN_Packet> fragmentORANPacket(const std::vector<uint8_t>& ecpriPayload, int totalSize)
-{
-    std::vector<ORAN_Packet> fragments;
-    // Calculate the number of fragments required
-    int numFragments = (totalSize + MAX_ALLOWED_ORANPACKET_SIZE - 1) / MAX_ALLOWED_ORANPACKET_SIZE;
 
-    for (int i = 0; i < numFragments; ++i) {
-        int fragmentSize = std::min(MAX_ALLOWED_ORANPACKET_SIZE, totalSize - i * MAX_ALLOWED_ORANPACKET_SIZE);
+// Built-in IQ payloads (ORAN.PayloadType random, qpsk, qam16, qam64, qam256, tone or pattern), generated straight
+// into the frames instead of read from a sample file. Every sample is a function of its position alone (seed, eAxC,
+// symbol and subcarrier), so any packet can be regenerated on its own, in any order and on any thread
+//  - random: uniformly distributed I and Q values from a counter-based hash
+//  - QAM: the same random words mapped to a square constellation, peak amplitude 32767
+//  - tone: a complex exponential of ORAN.TonePeriod samples per cycle along the sample sequence, subcarriers of a
+//    symbol first as in a stream IQ file
+//  - pattern: I and Q count up through the sample sequence, I = 2 n and Q = 2 n + 1 (16 bits) for sample n
+class IQPayloadGenerator
+{
+public:
+    enum Kind { Random, QAM, Tone, Pattern };
 
-        ORAN_Packet packet;
-        packet.oranPayload.insert(packet.oranPayload.begin(), ecpriPayload.begin() + i * MAX_ALLOWED_ORANPACKET_SIZE,
-                              ecpriPayload.begin() + i * MAX_ALLOWED_ORANPACKET_SIZE + fragmentSize);
+    IQPayloadGenerator() : kind(Random), seed(1), levels(0), scale(0) {}
 
-        fragments.push_back(packet);
+    // false for a name that is not a generated payload type (fixed and stream read the IQ file)
+    static bool Parse(const std::string& name, uint64_t seed, int tonePeriod, IQPayloadGenerator& generator)
+    {
+        generator = IQPayloadGenerator();
+        generator.seed = seed;
+        if (name == "random")
+            generator.kind = Random;
+        else if (name == "qpsk" || name == "qam16" || name == "qam64" || name == "qam256")
+        {
+            generator.kind = QAM;
+            generator.levels = name == "qpsk" ? 2 : name == "qam16" ? 4 : name == "qam64" ? 8 : 16;  // per axis
+            generator.scale = 23170 / (generator.levels - 1);  // corner points within 32767 of the origin
+        }
+        else if (name == "tone" && tonePeriod > 0)
+        {
+            generator.kind = Tone;
+            generator.tone.resize(tonePeriod);
+            for (int n = 0; n < tonePeriod; ++n)
+            {
+                double phase = 2 * M_PI * n / tonePeriod;
+                generator.tone[n] = Sample(static_cast<int16_t>(std::lround(23170 * std::cos(phase))),
+                                           static_cast<int16_t>(std::lround(23170 * std::sin(phase))));
+            }
+        }
+        else if (name == "pattern")
+            generator.kind = Pattern;
+        else
+            return false;
+        return true;
     }
 
-    return fragments;
-}
-
-// function to increment ECPRI.Seqid
-void increment_ECPRISeqid()
-{
-   eCPRI_Seqid++;
-   if(eCPRI_Seqid >255)
-   {
-       eCPRI_Seqid = 0 ;
-   }
-
-}
-
-void Calculations()
-{
-    // Calculations for frames , subframes , ... etc calculations
-        int Mu;
-        switch (oran_scs)
-         {
-           case 15:
-            Mu = 0;
+    // Write PRBs [prb, prb + numPrb) of symbol `symbolIndex` of stream `eAxC`, prbsPerSymbol PRBs per symbol:
+    // 12 subcarriers of little-endian int16 I then Q per PRB, IQSampleStore::BytesPerPRB bytes each
+    void Generate(uint8_t* out, uint8_t eAxC, uint64_t symbolIndex, uint32_t prb, uint32_t numPrb, uint32_t prbsPerSymbol) const
+    {
+        const uint32_t first = prb * 12;  // subcarrier within the symbol
+        const size_t count = static_cast<size_t>(numPrb) * 12;
+        switch (kind)
+        {
+        case Random:
+        case QAM:
+        {
+            // One 64-bit key per symbol and stream; subcarrier k of the symbol then gets Hash32(key + k) ^ (key >> 32)
+            uint64_t key = Mix64(Mix64(seed ^ (static_cast<uint64_t>(eAxC) << 56)) ^ symbolIndex);
+            RandomWords(static_cast<uint32_t>(key) + first, static_cast<uint32_t>(key >> 32), count, out);
             break;
-           case 30:
-            Mu = 1;
+        }
+        case Tone:
+        {
+            // whole runs of the period
+            size_t phase = (symbolIndex * prbsPerSymbol * 12 + first) % tone.size();
+            for (size_t done = 0; done < count;)
+            {
+                size_t run = std::min(count - done, tone.size() - phase);
+                std::memcpy(out + 4 * done, tone.data() + phase, 4 * run);
+                done += run;
+                phase = 0;
+            }
             break;
-           case 60:
-            Mu = 2;
+        }
+        case Pattern:
+            PatternWords(static_cast<uint16_t>((symbolIndex * prbsPerSymbol * 12 + first) * 2), count, out);
             break;
-           default:
-            std::cerr << "Invalid ORAN SCS value: " << oran_scs << std::endl;
-         }
-
-        slots = pow(2,Mu);
-        cout<<"Number of slots per subframe are "<<slots<<endl;
-
-        // step (1): Calculate the total number of frames
-        No_of_Frames = CaptureSizeMs / Frame_duration ;
-        cout<<"Number of Frames are "<<No_of_Frames<<endl;
-
-        // step (2): Calculate the total number of subframes
-        No_of_Subframes = No_of_Frames * 10 ; // 1 frame >> 10 subframe
-        cout<<"Number of Subframes are "<<No_of_Subframes<<endl;
-
-        // step (3): Calculate the total number of slots
-        No_of_Slots = No_of_Subframes * slots ;
-        cout<<"Number of total slots are "<<No_of_Slots<<endl;
+        }
+    }
 
-        // step (4): Calculate the total number of symbols
-        No_of_Symb = No_of_Slots * 14 ; // Assuming Normal CP
-        cout<<"Number of total Symbols are "<<No_of_Symb<<endl;
+private:
+    // I in the low half, Q in the high half: little-endian I then Q in memory
+    static uint32_t Sample(int16_t i, int16_t q)
+    {
+        return static_cast<uint16_t>(i) | static_cast<uint32_t>(static_cast<uint16_t>(q)) << 16;
+    }
 
-        // step (5): Calculate the number of packets per symbol
-        PacketsPerSymbol =  ceil(oran_Maxprb / oran_nrbPerPacket) ;
-        cout<<"Number of Packets per Symbol are "<<PacketsPerSymbol<<endl;
+    // SplitMix64 finalizer
+    static uint64_t Mix64(uint64_t x)
+    {
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
 
-        // step (6): Calculate the total number of ORAN packets
-        No_of_packets  = PacketsPerSymbol * No_of_Symb;
-        cout<<"Number of total ORAN Packets are "<<No_of_packets<<endl;
+    // Bijective 32-bit integer hash (lowbias32): distinct counters give distinct words
+    static uint32_t Hash32(uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x7FEB352Du;
+        x ^= x >> 15;
+        x *= 0x846CA68Bu;
+        return x ^ (x >> 16);
+    }
 
-        // step (7): Calculate the number of bits per packet
-        No_of_bits = oran_nrbPerPacket *12 * 2* 16;  // 1 RB >> 12 IQ sample assuming IQ bitwidth = 16 (16 for i and 16 for q)
-        cout<<"Number of bits per ORAN packet are "<<No_of_bits<<endl;
+    // out[i] = Hash32(counter + i) ^ mask as little-endian 32-bit words, mapped to constellation points for QAM:
+    // the low bits of each 16-bit half select the I and the Q level
+    void RandomWords(uint32_t counter, uint32_t mask, size_t count, uint8_t* out) const
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        static const bool avx2 = __builtin_cpu_supports("avx2");
+        if (avx2)
+            return RandomWordsAVX2(counter, mask, count, out);
+#endif
+        RandomWordsScalar(counter, mask, count, out);
+    }
 
-        double No_of_bytes =  No_of_bits / 8 ;
+    void RandomWordsScalar(uint32_t counter, uint32_t mask, size_t count, uint8_t* out) const
+    {
+        const uint32_t indexMask = levels - 1;
+        const int offset = static_cast<int>(levels) - 1;
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint32_t word = Hash32(counter + static_cast<uint32_t>(i)) ^ mask;
+            if (kind == QAM)
+                word = Sample(static_cast<int16_t>((2 * static_cast<int>(word & indexMask) - offset) * scale),
+                              static_cast<int16_t>((2 * static_cast<int>((word >> 16) & indexMask) - offset) * scale));
+            std::memcpy(out + 4 * i, &word, 4);
+        }
+    }
 
-        // step (8): Calculate the time of one packet
-        double T_packet = ((MaxPacketSize + (MinNumOfIFGsPerPacket*1)) * 8) / (LineRate * pow(10.0,9.0)) ;
+#if defined(__x86_64__) || defined(__i386__)
+    // Eight counters per iteration; the QAM levels are computed in both 16-bit halves at once
+    __attribute__((target("avx2")))
+    void RandomWordsAVX2(uint32_t counter, uint32_t mask, size_t count, uint8_t* out) const
+    {
+        const __m256i step = _mm256_set1_epi32(8);
+        const __m256i m1 = _mm256_set1_epi32(0x7FEB352D);
+        const __m256i m2 = _mm256_set1_epi32(static_cast<int>(0x846CA68Bu));
+        const __m256i xorMask = _mm256_set1_epi32(static_cast<int>(mask));
+        const __m256i indexMask = _mm256_set1_epi16(static_cast<int16_t>(levels - 1));
+        const __m256i levelStep = _mm256_set1_epi16(static_cast<int16_t>(2 * scale));
+        const __m256i levelOffset = _mm256_set1_epi16(static_cast<int16_t>((static_cast<int>(levels) - 1) * scale));
+        const bool qam = kind == QAM;
+        __m256i x0 = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(counter)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i x = _mm256_xor_si256(x0, _mm256_srli_epi32(x0, 16));
+            x = _mm256_mullo_epi32(x, m1);
+            x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15));
+            x = _mm256_mullo_epi32(x, m2);
+            x = _mm256_xor_si256(_mm256_xor_si256(x, _mm256_srli_epi32(x, 16)), xorMask);
+            if (qam)
+                x = _mm256_sub_epi16(_mm256_mullo_epi16(_mm256_and_si256(x, indexMask), levelStep), levelOffset);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 4 * i), x);
+            x0 = _mm256_add_epi32(x0, step);
+        }
+        RandomWordsScalar(counter + static_cast<uint32_t>(i), mask, count - i, out + 4 * i);
+    }
+#endif
 
-        // step (9): Calculate the total time taken by all packets in one frame
-        double TotalTime = T_packet * (No_of_packets /2);
+    // I = value + 2 i and Q = value + 2 i + 1 for sample i, wrapping at 16 bits
+    static void PatternWords(uint16_t value, size_t count, uint8_t* out)
+    {
+        size_t i = 0;
+#if defined(__SSE2__)
+        // four samples per iteration, each 16-bit lane counting on its own
+        __m128i values = _mm_add_epi16(_mm_set1_epi16(static_cast<int16_t>(value)), _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7));
+        const __m128i step = _mm_set1_epi16(8);
+        for (; i + 4 <= count; i += 4)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * i), values);
+            values = _mm_add_epi16(values, step);
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            uint16_t v = static_cast<uint16_t>(value + 2 * i);
+            uint32_t word = Sample(static_cast<int16_t>(v), static_cast<int16_t>(v + 1));
+            std::memcpy(out + 4 * i, &word, 4);
+        }
+    }
 
-        // step (10): Calculate if there is time left in frame after transmission is done to send IFGs
-        double Remaining_time = (Frame_duration / pow(10,3)) - TotalTime;
-        cout<<"Remaining time is "<<Remaining_time<<endl;
+    Kind kind;
+    uint64_t seed;
+    uint32_t levels;              // QAM levels per axis
+    int scale;                    // QAM distance from the origin to the nearest level
+    std::vector<uint32_t> tone;   // one period of the tone
+};
 
-        // step (11):
-        No_of_ifgs = Remaining_time / (((MinNumOfIFGsPerPacket*1) * 8) / (LineRate * pow(10.0,9.0)));
-        cout<<"Number of IFGs generated in the remaining time of the frame is "<<No_of_ifgs<<endl;
+// Helper function to convert string MAC address to uint64_t
+uint64_t macAddressToUInt64(const std::string& mac)
+{
+    uint64_t macAddress = 0;
+    std::istringstream iss(mac);
+    std::string byteStr;
+    while (std::getline(iss, byteStr, ':')) {
+        macAddress = (macAddress << 8) + std::stoul(byteStr, nullptr, 16);
+    }
+    return macAddress;
 }
 
-int main()
+// Slice-by-16 lookup tables for the reflected CRC32 polynomial, evaluated at compile time
+// T[0] is the classic byte table, T[k][i] is the CRC of byte i followed by k zero bytes
+typedef std::array<std::array<uint32_t, 256>, 16> CRC32TableSet;
+
+constexpr CRC32TableSet MakeCRC32Tables()
 {
-    //  Load setup file and iq file
-    std::string setupFilePath = "/Users/zeina/Desktop/Project/SetupFile.txt";
-    if (!readSetupFile(setupFilePath))
+    CRC32TableSet tables{};
+    for (uint32_t i = 0; i < 256; ++i)
     {
-        return 1;
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        }
+        tables[0][i] = crc;
     }
+    for (int k = 1; k < 16; ++k)
+    {
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t previous = tables[k - 1][i];
+            tables[k][i] = (previous >> 8) ^ tables[0][previous & 0xFF];
+        }
+    }
+    return tables;
+}
 
-    std::string iqFilePath = "/Users/zeina/Desktop/Project/iq_file.txt";
+// CRC32 engine used for the Ethernet FCS (IEEE 802.3, reflected polynomial 0xEDB88320)
+// The lookup tables are built at compile time, the carry-less multiply path is picked at runtime
+class CRC32Engine
+{
+public:
+    enum Variant { Bitwise, SliceBy8, SliceBy16, CarrylessMultiply, Auto };
 
-    std::cout << "Setup file parameters loaded successfully." << std::endl;
+    static const uint32_t Polynomial = 0xEDB88320;
 
-    // Calculations for frames , subframes , ... etc calculations
-    Calculations();
+    // Streaming API: feed the frame in any number of pieces then call Final()
+    explicit CRC32Engine(Variant variant = Auto) : variant(variant == Auto ? Best() : variant), state(0xFFFFFFFF) {}
 
-    std::vector<uint8_t> oranPayload = generateOranPayloadWithLooping(iqFilePath);
-    if (oranPayload.empty())
-    {
-        std::cerr << "Error generating ORAN payload." << std::endl;
-        return 1;
-    }
+    void Reset() { state = 0xFFFFFFFF; }
 
-    std::vector<uint8_t> ethernetPacketData;
+    void Update(const uint8_t* data, size_t length) { state = UpdateRaw(state, data, length, variant); }
 
-    // Output to file
-    std::ofstream OutputFile;
-    OutputFile.open("/Users/zeina/Desktop/Project/OutputPackets.txt");
+    void Update(const std::vector<uint8_t>& data) { Update(data.data(), data.size()); }
 
-    if (!OutputFile)
+    uint32_t Final() const { return ~state; }
+
+    // One-shot CRC of a buffer
+    static uint32_t Compute(const uint8_t* data, size_t length, Variant variant = Auto)
     {
-        std::cerr << "Error opening output file." << std::endl;
-        return 1;
+        return ~UpdateRaw(0xFFFFFFFF, data, length, variant);
     }
 
-    int byteCounter = 0;
-    uint16_t currentPrbu = 0;  // Initialize the starting PRB index
-
-// Loop through frames, subframes, slots, and symbols
-for (int frameId = 0; frameId < No_of_Frames; ++frameId)
-{
-    OutputFile <<"Frame : "<<frameId<<endl;
-    for (int subframeId = 0; subframeId < 10; ++subframeId)
+    // Advance a raw (non-inverted) CRC register over the given bytes
+    static uint32_t UpdateRaw(uint32_t crc, const uint8_t* data, size_t length, Variant variant)
     {
-       for (int slotId = 0; slotId < slots; ++slotId)
-       {
-          for (int symbolId = 0; symbolId < 14; ++symbolId)
-          {
-              // since one ethernet packet carries one ecrpi instance whcih in return contains one oran instance
-             // Therefore numbr of generated ethernet packets = number of generated ecpri packets = number of generated oran packets
-               for(int packetIndex = 0; packetIndex < PacketsPerSymbol ; ++packetIndex)
-                {
-                  std::cout << "Generating ORAN packet " << (packetIndex + 1) << "/" << PacketsPerSymbol << std::endl;
+        switch (variant == Auto ? Best() : variant)
+        {
+            case Bitwise:
+                return UpdateBitwise(crc, data, length);
+            case SliceBy8:
+                return UpdateSliceBy8(crc, data, length);
+            case CarrylessMultiply:
+                return UpdateCarrylessMultiply(crc, data, length);
+            default:
+                return UpdateSliceBy16(crc, data, length);
+        }
+    }
 
-                  // Generate ORAN packet
-                   ORAN_Packet oranPacket;
-                   oranPacket.FrameID= frameId;
-                   oranPacket.SubframeID = subframeId;
-                   oranPacket.SlotID = slotId;
-                   oranPacket.SymbolID = symbolId;
+    // Fastest variant supported by the CPU we are running on
+    static Variant Best()
+    {
+        static const Variant best = CarrylessMultiplySupported() ? CarrylessMultiply : SliceBy16;
+        return best;
+    }
 
-                  // Calculate startPrbu based on current packet index and PRB allocation
-                   oranPacket.startPrbu = currentPrbu;
-                   currentPrbu += oran_nrbPerPacket;
+    static bool CarrylessMultiplySupported()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+#else
+        return false;
+#endif
+    }
 
-                   std::vector<uint8_t> oranPacketData = oranPacket.GenerateORANPacket(oranPayload,oranPacket.startPrbu);
+    // Product of two polynomials modulo the CRC polynomial (reflected bit order, x^0 is bit 31)
+    static uint32_t MultiplyModP(uint32_t a, uint32_t b)
+    {
+        uint32_t product = 0;
+        for (uint32_t m = 1u << 31; m != 0; m >>= 1)
+        {
+            if (a & m)
+            {
+                product ^= b;
+            }
+            b = (b & 1) ? (b >> 1) ^ Polynomial : b >> 1;
+        }
+        return product;
+    }
 
-                  // check ths size of oran packets that it doesn't exceed 1466 if it does then it need fragmentation
-                   if (oranPacketData.size() > MAX_ALLOWED_ORANPACKET_SIZE)
-                    {
-                      cerr << "ORAN packet size exceeds the maximum allowed. Fragmenting ....." <<endl;
-                      auto fragmentedPackets = fragmentORANPacket(oranPacketData , oranPacketData.size());
+    // x^(8 * count) modulo the CRC polynomial: MultiplyModP(ZeroBytesOperator(n), raw) advances a
+    // raw CRC register over n zero bytes in constant time
+    static uint32_t ZeroBytesOperator(uint64_t count)
+    {
+        uint32_t result = 1u << 31;  // x^0
+        uint32_t square = 1u << 23;  // x^8
+        while (count)
+        {
+            if (count & 1)
+            {
+                result = MultiplyModP(result, square);
+            }
+            square = MultiplyModP(square, square);
+            count >>= 1;
+        }
+        return result;
+    }
 
-                      cout << "Number of fragments created: " << fragmentedPackets.size() << endl;
+    static const char* Name(Variant variant)
+    {
+        switch (variant)
+        {
+            case Bitwise:           return "bitwise";
+            case SliceBy8:          return "slice-by-8";
+            case SliceBy16:         return "slice-by-16";
+            case CarrylessMultiply: return "pclmulqdq";
+            default:                return "auto";
+        }
+    }
 
+    // Reference implementation, one bit at a time
+    static uint32_t UpdateBitwise(uint32_t crc, const uint8_t* data, size_t length)
+    {
+        for (size_t n = 0; n < length; ++n)
+        {
+            crc ^= data[n];
+            for (int i = 0; i < 8; ++i)
+            {
+                crc = (crc & 1) ? (crc >> 1) ^ Polynomial : crc >> 1;
+            }
+        }
+        return crc;
+    }
 
-                   for (auto &fragment : fragmentedPackets)
-                    {
-                      // Encapsulate the ORAN fragment in an eCPRI packet
-                      eCPRI_Packet ecpriPacket;
-                      std::vector<uint8_t> ecpriPacketData = ecpriPacket.GenerateECPRIPacket(fragment.oranPayload);
+    static uint32_t UpdateSliceBy8(uint32_t crc, const uint8_t* data, size_t length)
+    {
+        const auto& T = Tables;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        while (length >= 8)
+        {
+            uint32_t one, two;
+            std::memcpy(&one, data, 4);
+            std::memcpy(&two, data + 4, 4);
+            one ^= crc;
+            crc = T[7][one & 0xFF] ^ T[6][(one >> 8) & 0xFF] ^ T[5][(one >> 16) & 0xFF] ^ T[4][one >> 24] ^
+                  T[3][two & 0xFF] ^ T[2][(two >> 8) & 0xFF] ^ T[1][(two >> 16) & 0xFF] ^ T[0][two >> 24];
+            data += 8;
+            length -= 8;
+        }
+#endif
+        return UpdateBytewise(crc, data, length);
+    }
 
-                      // Encapsulate the eCPRI packet in an Ethernet packet
-                      EthernetPacket ethPacket;
-                      ethPacket.DestAddress = macAddressToUInt64(Dest_Address);
-                      ethPacket.SourceAddress = macAddressToUInt64(Source_Address);
-                      ethernetPacketData = ethPacket.GenerateEthernetPackets(ecpriPacketData);
+    static uint32_t UpdateSliceBy16(uint32_t crc, const uint8_t* data, size_t length)
+    {
+        const auto& T = Tables;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        while (length >= 16)
+        {
+            uint32_t one, two, three, four;
+            std::memcpy(&one, data, 4);
+            std::memcpy(&two, data + 4, 4);
+            std::memcpy(&three, data + 8, 4);
+            std::memcpy(&four, data + 12, 4);
+            one ^= crc;
+            crc = T[15][one & 0xFF] ^ T[14][(one >> 8) & 0xFF] ^ T[13][(one >> 16) & 0xFF] ^ T[12][one >> 24] ^
+                  T[11][two & 0xFF] ^ T[10][(two >> 8) & 0xFF] ^ T[9][(two >> 16) & 0xFF] ^ T[8][two >> 24] ^
+                  T[7][three & 0xFF] ^ T[6][(three >> 8) & 0xFF] ^ T[5][(three >> 16) & 0xFF] ^ T[4][three >> 24] ^
+                  T[3][four & 0xFF] ^ T[2][(four >> 8) & 0xFF] ^ T[1][(four >> 16) & 0xFF] ^ T[0][four >> 24];
+            data += 16;
+            length -= 16;
+        }
+#endif
+        return UpdateBytewise(crc, data, length);
+    }
 
-                      // Add IFG to align to 4 bytes
-                      ethPacket.AddIFG(ethernetPacketData);
+    // PCLMULQDQ folding (Intel "Fast CRC Computation Using PCLMULQDQ"), table driven for the tail
+    static uint32_t UpdateCarrylessMultiply(uint32_t crc, const uint8_t* data, size_t length)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        if (length >= 64 && CarrylessMultiplySupported())
+        {
+            size_t folded = length & ~size_t(15);
+            crc = FoldCarrylessMultiply(crc, data, folded);
+            data += folded;
+            length -= folded;
+        }
+#endif
+        return UpdateSliceBy16(crc, data, length);
+    }
 
-                      std::cout << "Generated Ethernet packet size: " << ethernetPacketData.size() << " bytes" << std::endl;
+private:
+    typedef CRC32TableSet TableSet;
 
-                      // increment ECPRI.Seqid for the next packet
-                      increment_ECPRISeqid();
+    static constexpr TableSet Tables = MakeCRC32Tables();
 
-                      // Write to output file
-                      for (uint8_t byte : ethernetPacketData)
-                       {
-                         OutputFile << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(byte) << " ";
-                         byteCounter++;
+    static uint32_t UpdateBytewise(uint32_t crc, const uint8_t* data, size_t length)
+    {
+        for (size_t n = 0; n < length; ++n)
+        {
+            crc = (crc >> 8) ^ Tables[0][(crc ^ data[n]) & 0xFF];
+        }
+        return crc;
+    }
 
-                        if (byteCounter % 4 == 0)
-                        {
-                          OutputFile << "\n";
-                        }
-                       }
-                     }
-                    }
-                   else
-                {
-                  // In case no need for fragmentation
-                 // Encapsulate the ORAN fragment in an eCPRI packet
-                 eCPRI_Packet ecpriPacket;
-                 std::vector<uint8_t> ecpriPacketData = ecpriPacket.GenerateECPRIPacket(oranPacketData);
+#if defined(__x86_64__) || defined(__i386__)
+    // length must be a multiple of 16 and at least 64
+    __attribute__((target("pclmul,sse4.1")))
+    static uint32_t FoldCarrylessMultiply(uint32_t crc, const uint8_t* data, size_t length)
+    {
+        const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+        const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+        const __m128i k5k0 = _mm_set_epi64x(0x0000000000, 0x0163cd6124);
+        const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+        const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
 
-                // Encapsulate the eCPRI packet in an Ethernet packet
-                EthernetPacket ethPacket;
-                ethPacket.DestAddress = macAddressToUInt64(Dest_Address);
-                ethPacket.SourceAddress = macAddressToUInt64(Source_Address);
-                ethernetPacketData = ethPacket.GenerateEthernetPackets(ecpriPacketData);
+        __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x00));
+        __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x10));
+        __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x20));
+        __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x30));
+        x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+        data += 64;
+        length -= 64;
 
-                // Add IFG to align to 4 bytes
-                ethPacket.AddIFG(ethernetPacketData);
+        // Fold four 128-bit lanes in parallel, 64 bytes per iteration
+        while (length >= 64)
+        {
+            __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+            __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+            __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+            __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+            x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+            x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+            x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+            x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+            x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x00)));
+            x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x10)));
+            x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x20)));
+            x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x30)));
+            data += 64;
+            length -= 64;
+        }
 
-                cout << "Generated Ethernet packet size: " << ethernetPacketData.size() << " bytes" << endl;
+        // Fold the four lanes into one
+        __m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x2), x5);
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x3), x5);
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x4), x5);
 
-                // increment ECPRI.Seqid for the next packet
-                increment_ECPRISeqid();
+        // Remaining 16-byte blocks
+        while (length >= 16)
+        {
+            x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+            x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+            x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+            data += 16;
+            length -= 16;
+        }
 
-                // Write to the output file
-                 for (uint8_t byte : ethernetPacketData)
-                 {
-                   OutputFile << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(byte) << " ";
-                   byteCounter++;
+        // Fold 128 bits down to 64
+        x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+        x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+        x2 = _mm_srli_si128(x1, 4);
+        x1 = _mm_and_si128(x1, mask32);
+        x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k5k0, 0x00), x2);
 
-                   if (byteCounter % 4 == 0)
-                    {
-                     OutputFile << "\n";
-                    }
-                 }
+        // Barrett reduction to 32 bits
+        x2 = _mm_and_si128(x1, mask32);
+        x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+        x2 = _mm_and_si128(x2, mask32);
+        x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+        x1 = _mm_xor_si128(x1, x2);
+        return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+    }
+#endif
 
-                }
+    Variant variant;
+    uint32_t state;
+};
 
-     OutputFile << endl;
+class EthernetPacket {
+public:
+    static const uint64_t PreambleAndSFD = 0xFB555555555555D5; // 8 bytes (64 bits)
+    uint64_t DestAddress;  // 6 bytes (48 bits)
+    uint64_t SourceAddress; // 6 bytes (48 bits)
+    static const uint16_t EtherType = 0xAEFE;  // 2 bytes (16 bits), eCPRI Protocol
+    std::vector<uint8_t> Payload;  // varies from 46 to 1474 bytes
+    uint32_t FCS;  // 4 bytes (32 bits)
+    const int MaxPayloadSize = 1474;
+    const int MinPayloadSize = 46;
 
+    // Fixed layout of a frame in a buffer: preamble/SFD, MAC header, payload, FCS
+    static const size_t PreambleSize = 8;
+    static const size_t HeaderSize = 14;
+    static const size_t PayloadOffset = PreambleSize + HeaderSize;
+    static const size_t FCSSize = 4;
+
+    // Generate the payload with the size ensuring it's within valid bounds
+    void GeneratePayload(size_t PayloadSize)
+    {
+        if (PayloadSize < MinPayloadSize)
+        {
+            PayloadSize = MinPayloadSize; // Payload = 46 bytes
+        }
+        else if (PayloadSize > MaxPayloadSize)
+        {
+            PayloadSize = MaxPayloadSize; // Payload = 1474 bytes
+        }
 
-          }
-       }
     }
-  }
 
-          // Add IFGs to be sent in the remaining time of the frame
-          OutputFile <<"\nSending IFGs in the remaining time...."<<endl;
-          for(int k = 0 ; k < No_of_ifgs ; k++)
+    // Compute CRC32 for the given frame (destination address up to the end of the payload, without FCS)
+    uint32_t ComputeCRC32(const std::vector<uint8_t>& frame) {
+        return CRC32Engine::Compute(frame.data(), frame.size());
+    }
+
+   // Function to generate the full Ethernet packets
+    std::vector<uint8_t> GenerateEthernetPackets(const std::vector<uint8_t>& etherpayload) // pass the ecpri packet as an argument
+    {
+          std::vector<uint8_t> Packet;
+
+          // 1. Add Preamble and SFD (8 bytes)
+          uint64_t preambleandSFD = PreambleAndSFD;
+          for (int i = 7; i >= 0; --i)
+            {
+              Packet.push_back((preambleandSFD >> (i * 8)) & 0xFF); //shift right by i bytes
+            }
+
+          // 2. Add Destination MAC Address (6 bytes)
+          for (int i = 5; i >= 0; --i)
+            {
+              Packet.push_back((DestAddress >> (i * 8)) & 0xFF);
+            }
+
+          // 3. Add Source MAC Address (6 bytes)
+          for (int i = 5; i >= 0; --i)
+            {
+              Packet.push_back((SourceAddress >> (i * 8)) & 0xFF);
+            }
+
+          // 4. Add EtherType (2 bytes)
+          uint16_t etherType = EtherType;
+          for (int i = 1; i >= 0; --i)
+            {
+              Packet.push_back((etherType >> (i * 8)) & 0xFF);
+            }
+
+          // 5. Add Payload
+          // check on payload if it needs fragmentation
+          Packet.insert(Packet.end(),etherpayload.begin(),etherpayload.end());
+
+          // 6. Compute FCS over the header and the payload (preamble/SFD and the FCS itself are not covered)
+          CRC32Engine crc;
+          crc.Update(Packet.data() + 8, Packet.size() - 8 - etherpayload.size());
+          crc.Update(etherpayload);
+          FCS = crc.Final();
+
+          // 7. Add FCS (4 bytes), transmitted least significant byte first
+          for (int i = 0; i <= 3; ++i)
+            {
+              Packet.push_back((FCS >> (i * 8)) & 0xFF);
+            }
+
+    return Packet;
+   }
+
+    // Write preamble/SFD, addresses and EtherType around a payload already placed at frame + PayloadOffset,
+    // then append the FCS. Returns the frame length (preamble/SFD up to the FCS)
+    size_t EncapsulateInPlace(uint8_t* frame, size_t payloadSize)
+    {
+        for (int i = 7; i >= 0; --i)
+          {
+            *frame++ = (PreambleAndSFD >> (i * 8)) & 0xFF;
+          }
+        for (int i = 5; i >= 0; --i)
+          {
+            *frame++ = (DestAddress >> (i * 8)) & 0xFF;
+          }
+        for (int i = 5; i >= 0; --i)
+          {
+            *frame++ = (SourceAddress >> (i * 8)) & 0xFF;
+          }
+        *frame++ = (EtherType >> 8) & 0xFF;
+        *frame++ = EtherType & 0xFF;
+
+        uint8_t* header = frame - HeaderSize;
+        FCS = CRC32Engine::Compute(header, HeaderSize + payloadSize);
+        uint8_t* fcs = frame + payloadSize;
+        for (int i = 0; i <= 3; ++i)
           {
-            OutputFile << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(0x07) << " ";
-            if ((k + 1) % 4 == 0)
+            fcs[i] = (FCS >> (i * 8)) & 0xFF;
+          }
+        return PayloadOffset + payloadSize + FCSSize;
+    }
+
+    // Add Inter-Frame Gap (IFG)
+    void AddIFG(std::vector<uint8_t>& Packet)
+    {
+        const uint8_t IFG = 0x07 ;
+        while (Packet.size() % 4 != 0)
+         {
+            Packet.push_back(IFG);  // Add one-byte IFG (0x07) to make it 4-byte aligned
+         }
+    }
+
+    // Number of IFG bytes AddIFG appends to a packet of the given size
+    static size_t AlignmentIFGs(size_t packetSize)
+    {
+        return (4 - packetSize % 4) % 4;
+    }
+
+    // IFG bytes sent after a packet: at least minIFGs, and as many more as realign the next packet to 4 bytes
+    static size_t GapIFGs(size_t packetSize, int minIFGs)
+    {
+        size_t gap = minIFGs > 0 ? minIFGs : 0;
+        return gap + AlignmentIFGs(packetSize + gap);
+    }
+};
+
+class eCPRI_Packet : public EthernetPacket
+{
+    public:
+    const uint8_t eCPRI_Version = 0x00 ; // first byte is zero dummies
+    const uint8_t eCPRI_Message = 0x00 ; // user plane (indicates the type of service conveyed by the message type)
+    size_t eCPRI_Payload ; // indicates the size in bytes of the payload part , Max supported payload = 65535 bits = 8191.875 bytes
+    const double MaxSupprotedPayload = 8191.875;
+    uint8_t eCPRI_PC_RTC = 0x00 ;  // eAxC ID of the stream (0 for a single stream)
+    uint8_t eCPRI_SeqId = 0 ;  // SeqId written by WriteHeader and GenerateECPRIPacket, set by the caller
+
+    // default constructor
+    eCPRI_Packet ()
+    {
+
+    }
+
+    // function to generate ECPRI packet
+    std::vector<uint8_t> GenerateECPRIPacket (const std::vector<uint8_t>& oranPacket) // takes oran packet as an argument to be its payload
+    {
+        std::vector<uint8_t> eCPRIPacket;
+
+        // 1. Add first byte
+           eCPRIPacket.push_back(eCPRI_Version);
+
+        // 2. Add ecpriMessage
+           eCPRIPacket.push_back(eCPRI_Message);
+
+        // 3. Add ecpriPayload
+            size_t eCPRI_Payload = oranPacket.size();
+            if (eCPRI_Payload > MaxSupprotedPayload)
+            {
+                cerr << "Packet size is not valid , increase maxPacketSize or decrease the NRBs used." << endl;
+            }
+            else
+            {
+                eCPRIPacket.push_back(static_cast<uint8_t>(eCPRI_Payload >> 8));  // Higher byte of the size
+                eCPRIPacket.push_back(static_cast<uint8_t>(eCPRI_Payload & 0xFF)); // Lower byte of the size
+            }
+
+        // 4. Add ecpriPC/RTC
+           eCPRIPacket.push_back(eCPRI_PC_RTC);
+
+        // 5. Add ecpriSeqid
+           eCPRIPacket.push_back(eCPRI_SeqId);
+
+        // 6. Add ORAN packet as ecpri payload
+           eCPRIPacket.insert(eCPRIPacket.end(), oranPacket.begin(), oranPacket.end());
+
+       return eCPRIPacket;
+    }
+
+    static const size_t HeaderSize = 6;
+    static const size_t PayloadOffset = EthernetPacket::PayloadOffset + HeaderSize;  // offset of the ORAN packet in the frame
+
+    // Write the eCPRI header in place at frame + EthernetPacket::PayloadOffset, the payload follows it
+    void WriteHeader(uint8_t* frame, size_t payloadSize)
+    {
+        uint8_t* header = frame + EthernetPacket::PayloadOffset;
+        header[0] = eCPRI_Version;
+        header[1] = eCPRI_Message;
+        if (payloadSize > MaxSupprotedPayload)
+        {
+            cerr << "Packet size is not valid , increase maxPacketSize or decrease the NRBs used." << endl;
+        }
+        header[2] = static_cast<uint8_t>(payloadSize >> 8);
+        header[3] = static_cast<uint8_t>(payloadSize & 0xFF);
+        header[4] = eCPRI_PC_RTC;
+        header[5] = eCPRI_SeqId;
+    }
+
+
+};
+
+class ORAN_Packet : public eCPRI_Packet
+{
+    public:
+    const uint8_t ORAN_FirstByte = 0x00 ;  // includes dataDirection , payloadVersion and filterIndex
+    const uint16_t SectionID = 0x000 ;
+    unsigned rb : 1 ; // 1 bit field for rb
+    unsigned symInc : 1 ;  // 1 bit field for symInc
+    uint8_t FrameID , SubframeID , SlotID , SymbolID ;
+    uint8_t numPrbu = oran_nrbPerPacket; // numPrbu field : number of contiguous PRBs per data section
+    uint16_t startPrbu; //used to indicate the starting Physical Resource Block (PRB) unit within a specific data section
+    IQCompressor compression;  // udCompHdr follows the section header unless the payload is uncompressed 16-bit
+    std::vector<uint8_t> oranPayload;
+    // Constructor to initialize fields
+    ORAN_Packet()
+        : rb(0), symInc(0), FrameID(0), SubframeID(0), SlotID(0), SymbolID(0), startPrbu(0)
+    {}
+
+    // function to generate full ORAN packet
+    std::vector<uint8_t> GenerateORANPacket(const std::vector<uint8_t>& payload, uint16_t startPrbu)
+    {
+       std::vector<uint8_t> ORANPacket;
+
+          // 1. Add the first byte (dataDirection, payloadVersion, and filterIndex combined)
+             ORANPacket.push_back(ORAN_FirstByte);
+
+          // 2. Add FrameId
+             ORANPacket.push_back(FrameID);
+
+          // 3. Combine SubframeID (4 bits) with the first 4 bits of SlotID to make 1 byte
+             uint8_t combinedHeader1 = (SubframeID << 4) | ((SlotID >> 2) & 0x0F);
+             ORANPacket.push_back(combinedHeader1);
+
+          // 4. Combine the remaining 2 bits of SlotID with SymbolID (6 bits) to make 1 byte
+             uint8_t combinedHeader2 = ((SlotID & 0x03) << 6) | (SymbolID & 0x3F);
+             ORANPacket.push_back(combinedHeader2);
+
+          // 5. Add first 8 bits of the SectionID
+             ORANPacket.push_back(static_cast<uint8_t>((SectionID >> 4) & 0xFF));
+
+          // 6. Combine the remaining 4 bits of SectionID with rb, symInc, and the first 2 bits of startPrbu
+             uint8_t combinedField = ((SectionID & 0x0F) << 4) | ((rb << 3) | (symInc << 2) | ((startPrbu >> 8) & 0x03));
+             ORANPacket.push_back(combinedField);
+
+          // 7. Add the remaining 8 bits of startPrbu
+             ORANPacket.push_back(static_cast<uint8_t>(startPrbu & 0xFF));
+
+          // 8. Add numPrbu (1 byte)
+             ORANPacket.push_back(numPrbu);
+
+          // udCompHdr and the reserved byte for compressed payloads
+             if (!compression.Legacy())
              {
-                OutputFile << "\n";
+                 ORANPacket.push_back(compression.UdCompHdr());
+                 ORANPacket.push_back(0);
              }
-          }
 
-           OutputFile << endl;
+          // 9. Add Payload
+             oranPayload = payload;
+             ORANPacket.insert(ORANPacket.end(), oranPayload.begin(), oranPayload.end());
+
+      return ORANPacket;
+   }
 
+    static const size_t HeaderSize = 8;
+    static const size_t PayloadOffset = eCPRI_Packet::PayloadOffset + HeaderSize;  // offset of the IQ samples in the frame
+    static const size_t CompressionHeaderSize = 2;  // udCompHdr and reserved byte
 
-}
-    OutputFile.close();
+    // Section header bytes before the IQ payload
+    size_t SectionHeaderSize() const { return HeaderSize + (compression.Legacy() ? 0 : CompressionHeaderSize); }
+
+    // Write the ORAN header in place at frame + eCPRI_Packet::PayloadOffset
+    void WriteHeader(uint8_t* frame)
+    {
+        uint8_t* header = frame + eCPRI_Packet::PayloadOffset;
+        header[0] = ORAN_FirstByte;
+        header[1] = FrameID;
+        header[2] = (SubframeID << 4) | ((SlotID >> 2) & 0x0F);
+        header[3] = ((SlotID & 0x03) << 6) | (SymbolID & 0x3F);
+        header[4] = static_cast<uint8_t>((SectionID >> 4) & 0xFF);
+        header[5] = ((SectionID & 0x0F) << 4) | ((rb << 3) | (symInc << 2) | ((startPrbu >> 8) & 0x03));
+        header[6] = static_cast<uint8_t>(startPrbu & 0xFF);
+        header[7] = numPrbu;
+        if (!compression.Legacy())
+        {
+            header[8] = compression.UdCompHdr();
+            header[9] = 0;
+        }
+    }
+
+    // Encode one complete Ethernet frame into `frame` carrying this section: the section header followed by the
+    // IQ payload `iq` (numPrbu PRBs from startPrbu). Headers are written at their fixed offsets and the IQ bytes are
+    // copied once, straight from the sample buffer to their final place. Returns the frame length
+    size_t EncodeFrame(uint8_t* frame, const IQView& iq)
+    {
+        iq.CopyTo(SectionPayload(frame), 0, iq.length);
+        return EncodeSection(frame, iq.length);
+    }
+
+    // Where the IQ payload of this section goes in `frame`
+    uint8_t* SectionPayload(uint8_t* frame) const { return frame + eCPRI_Packet::PayloadOffset + SectionHeaderSize(); }
+
+    // Encode the headers and FCS of a frame whose `payloadSize` IQ bytes were already written at SectionPayload(frame).
+    // Returns the frame length
+    size_t EncodeSection(uint8_t* frame, size_t payloadSize)
+    {
+        WriteHeader(frame);
+        size_t ecpriPayloadSize = SectionHeaderSize() + payloadSize;
+        eCPRI_Packet::WriteHeader(frame, ecpriPayloadSize);
+        return EncapsulateInPlace(frame, eCPRI_Packet::HeaderSize + ecpriPayloadSize);
+    }
+
+};
+
+// Pre-encoded frame for one fragment of a fixed IQ payload (ORAN.PayloadType=fixed)
+// Between packets only the eCPRI SeqId and the ORAN FrameID/SubframeID/SlotID/SymbolID/startPrbu bytes change,
+// so a packet is produced by patching those bytes and folding the CRC of the byte difference into the FCS
+// (CRC linearity) instead of recomputing the FCS over the whole frame
+class FrameTemplate
+{
+public:
+    FrameTemplate() : length(0), shiftOperator(0) {}
+
+    bool Built() const { return length != 0; }
+
+    size_t Length() const { return length; }
+
+    // Encode the template once, same as ORAN_Packet::EncodeFrame
+    void Build(ORAN_Packet& prototype, const IQView& iq)
+    {
+        frame.assign(eCPRI_Packet::PayloadOffset + prototype.SectionHeaderSize() + iq.length + EthernetPacket::FCSSize, 0);
+        length = prototype.EncodeFrame(frame.data(), iq);
+
+        // Bytes covered by the FCS after the patched window
+        size_t trailing = length - EthernetPacket::FCSSize - (PatchOffset + PatchSize);
+        shiftOperator = CRC32Engine::ZeroBytesOperator(trailing);
+    }
+
+    // Rewrite the header fields of `packet` and the SeqId into the template, update the FCS and return the frame
+    const uint8_t* Patch(ORAN_Packet& packet, uint8_t seqId)
+    {
+        uint8_t* window = frame.data() + PatchOffset;
+        uint8_t previous[PatchSize];
+        std::memcpy(previous, window, PatchSize);
+
+        window[0] = seqId;
+        packet.WriteHeader(frame.data());
+
+        uint8_t delta[PatchSize];
+        for (size_t i = 0; i < PatchSize; ++i)
+        {
+            delta[i] = previous[i] ^ window[i];
+        }
+        uint32_t crcDelta = CRC32Engine::UpdateRaw(0, delta, PatchSize, CRC32Engine::SliceBy8);
+        crcDelta = CRC32Engine::MultiplyModP(shiftOperator, crcDelta);
+
+        uint8_t* fcs = frame.data() + length - EthernetPacket::FCSSize;
+        for (int i = 0; i <= 3; ++i)
+        {
+            fcs[i] ^= (crcDelta >> (i * 8)) & 0xFF;
+        }
+        return frame.data();
+    }
+
+private:
+    static const size_t PatchOffset = EthernetPacket::PayloadOffset + 5;   // eCPRI SeqId
+    static const size_t PatchSize = 1 + ORAN_Packet::HeaderSize;          // SeqId and the whole ORAN header
+
+    std::vector<uint8_t> frame;
+    size_t length;
+    uint32_t shiftOperator;
+};
+
+bool PlanFrameBudget(double& remainingSeconds, int& fillIFGs, bool& bursts);
+
+void Calculations()
+{
+    // Calculations for frames , subframes , ... etc calculations
+        int Mu;
+        switch (oran_scs)
+         {
+           case 15:
+            Mu = 0;
+            break;
+           case 30:
+            Mu = 1;
+            break;
+           case 60:
+            Mu = 2;
+            break;
+           default:
+            std::cerr << "Invalid ORAN SCS value: " << oran_scs << std::endl;
+            return;
+         }
+
+        slots = pow(2,Mu);
+        cout<<"Number of slots per subframe are "<<slots<<endl;
+
+        // step (1): Calculate the total number of frames
+        No_of_Frames = CaptureSizeMs / Frame_duration ;
+        cout<<"Number of Frames are "<<No_of_Frames<<endl;
+
+        // step (2): Calculate the total number of subframes
+        No_of_Subframes = No_of_Frames * 10 ; // 1 frame >> 10 subframe
+        cout<<"Number of Subframes are "<<No_of_Subframes<<endl;
+
+        // step (3): Calculate the total number of slots
+        No_of_Slots = No_of_Subframes * slots ;
+        cout<<"Number of total slots are "<<No_of_Slots<<endl;
+
+        // step (4): Calculate the total number of symbols
+        No_of_Symb = No_of_Slots * 14 ; // Assuming Normal CP
+        cout<<"Number of total Symbols are "<<No_of_Symb<<endl;
+
+        // step (5): Calculate the number of packets per symbol
+        PacketsPerSymbol =  ceil(oran_Maxprb / oran_nrbPerPacket) ;
+        cout<<"Number of Packets per Symbol are "<<PacketsPerSymbol<<endl;
+
+        // step (6): Calculate the total number of ORAN packets
+        No_of_packets  = PacketsPerSymbol * No_of_Symb;
+        cout<<"Number of total ORAN Packets are "<<No_of_packets<<endl;
+
+        // step (7): Calculate the number of bits per packet
+        No_of_bits = oran_nrbPerPacket *12 * 2* oran_iqWidth;  // 1 RB >> 12 IQ sample of ORAN.IQBitWidth bits for i and for q
+        if (oran_compMethod == "bfp")
+        {
+            No_of_bits += oran_nrbPerPacket * 8;  // udCompParam exponent byte per RB
+        }
+        cout<<"Number of bits per ORAN packet are "<<No_of_bits<<endl;
+
+        // steps (8) - (10): time on the wire of the packets of one frame, fragments and IFG gaps included, and the
+        // time left in the frame; exact from the split plan and the timeline (PlanFrameBudget), which does not place
+        // bursts
+        double Remaining_time = 0;
+        bool bursts = false;
+        No_of_ifgs = 0;
+        if (!PlanFrameBudget(Remaining_time, No_of_ifgs, bursts))
+        {
+            std::cerr << "Invalid settings for the frame budget." << std::endl;
+            return;
+        }
+        if (bursts)
+        {
+            cout<<"Remaining time and IFGs are not planned with bursts (Eth.BurstSize)"<<endl;
+            return;
+        }
+        cout<<"Remaining time is "<<Remaining_time<<endl;
+
+        // step (11): the IFGs filling the idle time of the frame (of its symbols or slots with Eth.IFGFill)
+        cout<<"Number of IFGs generated in the remaining time of the frame is "<<No_of_ifgs<<endl;
+}
+
+// One Ethernet frame of an ORAN packet: a section of whole PRBs with a header of its own, decodable alone
+struct SectionFragment
+{
+    int startPrb;
+    int numPrb;
+    size_t iqOffset;     // first IQ byte of the section within the packet's payload
+    size_t frameLength;  // preamble/SFD up to the FCS
+};
+
+// Position of one ORAN packet inside a symbol and the Ethernet frames it is split into, the same for every symbol
+struct PacketLayout
+{
+    int startPrb;
+    int numPrb;
+    size_t oranSize;     // ORAN header + IQ bytes
+    int firstFragment;   // in CaptureGenerator::Fragments()
+    int fragments;       // Ethernet frames carrying the packet
+};
+
+// Encoded Ethernet frames of one slot, back to back in one buffer, in output order
+struct PacketBatch
+{
+    struct Packet
+    {
+        size_t offset;          // first byte in `bytes`
+        size_t length;          // preamble/SFD up to the FCS
+        uint64_t timestampNs;   // start on the wire, set by PacketScheduler when the packet is written
+        int stream;             // index in the StreamSet
+        int symbolId;
+        int packetIndex;        // ORAN packet within the symbol
+        int fragmentIndex;
+        int fragmentCount;
+    };
+
+    std::vector<uint8_t> bytes;
+    std::vector<Packet> packets;
+    size_t used = 0;
+
+    void Reset(size_t capacity)
+    {
+        if (bytes.size() < capacity)
+            bytes.resize(capacity);
+        packets.clear();
+        used = 0;
+    }
+};
+
+// Antenna-carrier streams (eAxC) sharing the link, one array per field
+// A stream is an index into the arrays; its eAxC ID goes in the eCPRI PC_RTC byte and it counts its own SeqIds
+struct StreamSet
+{
+    std::vector<uint8_t> eAxC;
+    std::vector<uint8_t> firstSeqId;               // SeqId of the stream's first frame
+    std::vector<const IQSampleStore*> samples;     // IQ source of the stream
+    const IQPayloadGenerator* generator = nullptr; // built-in payload of every stream instead of the samples
+
+    size_t Count() const { return eAxC.size(); }
+
+    void Add(uint8_t id, uint8_t seqId, const IQSampleStore* source)
+    {
+        eAxC.push_back(id);
+        firstSeqId.push_back(seqId);
+        samples.push_back(source);
+    }
+
+    // Parse the comma-separated ORAN.eAxC list; false on a value outside 0..255 or a repeated ID
+    static bool ParseIds(const std::string& list, std::vector<uint8_t>& ids)
+    {
+        std::istringstream items(list);
+        std::string item;
+        while (std::getline(items, item, ','))
+        {
+            int id;
+            std::from_chars_result result = std::from_chars(item.data(), item.data() + item.size(), id);
+            if (result.ec != std::errc() || result.ptr != item.data() + item.size() || id < 0 || id > 255 ||
+                std::find(ids.begin(), ids.end(), id) != ids.end())
+                return false;
+            ids.push_back(static_cast<uint8_t>(id));
+        }
+        return !ids.empty();
+    }
+};
+
+// Per-thread encoding state
+struct EncoderState
+{
+    std::vector<uint8_t> raw;  // generated samples waiting to be compressed
+
+    // With a fixed payload a packet's bytes only depend on its stream and PRB count: stream s uses
+    // templates[2 s] for full packets and templates[2 s + 1] for the shorter last packet of a symbol
+    std::vector<std::vector<FrameTemplate>> templates;
+};
+
+// Encoder of the slots of a run, chosen once at startup: the generic CaptureGenerator or a FixedSlotEncoder
+// specialized on the run's settings. Both produce the same bytes
+class SlotEncoder
+{
+public:
+    virtual ~SlotEncoder() {}
+    virtual void EncodeSlot(uint64_t frameId, int subframeId, int slotId, EncoderState& state, PacketBatch& batch) const = 0;
+    virtual const char* Name() const = 0;
+};
+
+// Encodes any slot of the capture from its position alone. Every symbol has the same packet layout, so the
+// SeqId of a packet follows in closed form from the number of frames of its stream before it, and slots can
+// be encoded in any order and on any thread with the same result as a sequential run
+// Within a symbol the streams are interleaved packet by packet: ORAN packet k of every stream, then packet k + 1
+class CaptureGenerator : public SlotEncoder
+{
+public:
+    // The split plan is computed here once: false if a single PRB does not fit in Eth.MaxPacketSize
+    // The numerology and packet geometry default to the setup file globals
+    bool Setup(const StreamSet& streams, bool streamPayload, bool useTemplates,
+               uint64_t destAddress, uint64_t sourceAddress, const IQCompressor& compression,
+               int slotsPerSubframe = slots, int prbsPerSymbol = static_cast<int>(oran_Maxprb),
+               int prbsPerPacket = static_cast<int>(oran_nrbPerPacket), int maxPacketSize = MaxPacketSize)
+    {
+        this->streams = streams;
+        this->compression = compression;
+        this->streamPayload = streamPayload;
+        this->useTemplates = useTemplates;
+        this->destAddress = destAddress;
+        this->sourceAddress = sourceAddress;
+        this->slotsPerSubframe = slotsPerSubframe;
+        this->prbsPerSymbol = prbsPerSymbol;
+        this->prbsPerPacket = prbsPerPacket;
+        this->maxPacketSize = maxPacketSize;
+        if (prbsPerPacket < 1)
+            return false;
+        const int packetsPerSymbol = (prbsPerSymbol + prbsPerPacket - 1) / prbsPerPacket;
+
+        // Eth.MaxPacketSize bounds the Ethernet payload: eCPRI header, section header and whole PRBs, within the
+        // supported eCPRI payload size. numPrbu holds up to 255 PRBs, 0 standing for all PRBs of the symbol
+        const size_t headerSize = ORAN_Packet::HeaderSize + (compression.Legacy() ? 0 : ORAN_Packet::CompressionHeaderSize);
+        const size_t prbBytes = compression.PRBBytes();
+        const size_t maxECPRIPayload = static_cast<size_t>(eCPRI_Packet().MaxSupprotedPayload);
+        const size_t maxORANBytes = std::min(maxPacketSize > static_cast<int>(eCPRI_Packet::HeaderSize) ? maxPacketSize - eCPRI_Packet::HeaderSize : 0,
+                                             maxECPRIPayload);
+        const int prbsPerFragment = static_cast<int>(std::min<size_t>(maxORANBytes > headerSize ? (maxORANBytes - headerSize) / prbBytes : 0, 255));
+        if (prbsPerFragment == 0)
+            return false;
+
+        layout.clear();
+        fragments.clear();
+        framesPerSymbol = 0;
+        maxSlotBytes = 0;
+        for (int packetIndex = 0, prb = 0; packetIndex < packetsPerSymbol; ++packetIndex)
+        {
+            PacketLayout packet;
+            packet.startPrb = prb;
+            packet.numPrb = std::min(prbsPerPacket, prbsPerSymbol - prb);
+            packet.oranSize = headerSize + packet.numPrb * prbBytes;
+            packet.firstFragment = static_cast<int>(fragments.size());
+
+            // A whole-symbol packet that fits in one frame stays one section with numPrbu 0
+            bool whole = packet.numPrb == prbsPerSymbol && packet.oranSize <= maxORANBytes;
+            for (int done = 0; done < packet.numPrb;)
+            {
+                SectionFragment fragment;
+                fragment.startPrb = packet.startPrb + done;
+                fragment.numPrb = whole ? packet.numPrb : std::min(prbsPerFragment, packet.numPrb - done);
+                fragment.iqOffset = done * prbBytes;
+                fragment.frameLength = eCPRI_Packet::PayloadOffset + headerSize + fragment.numPrb * prbBytes + EthernetPacket::FCSSize;
+                fragments.push_back(fragment);
+                maxSlotBytes += fragment.frameLength * 14 * streams.Count();
+                done += fragment.numPrb;
+            }
+            packet.fragments = static_cast<int>(fragments.size()) - packet.firstFragment;
+            framesPerSymbol += packet.fragments;
+            layout.push_back(packet);
+            prb += packet.numPrb;
+        }
+        return true;
+    }
+
+    const std::vector<PacketLayout>& Layout() const { return layout; }
+    const std::vector<SectionFragment>& Fragments() const { return fragments; }
+    int FramesPerSymbol() const { return framesPerSymbol; }   // per stream
+    size_t StreamCount() const { return streams.Count(); }
+    const StreamSet& Streams() const { return streams; }
+    const IQCompressor& Compression() const { return compression; }
+    bool StreamPayload() const { return streamPayload; }
+    bool UseTemplates() const { return useTemplates; }
+    uint64_t DestAddress() const { return destAddress; }
+    uint64_t SourceAddress() const { return sourceAddress; }
+    size_t MaxSlotBytes() const { return maxSlotBytes; }
+    int SlotsPerSubframe() const { return slotsPerSubframe; }
+    int PrbsPerSymbol() const { return prbsPerSymbol; }
+    int PrbsPerPacket() const { return prbsPerPacket; }
+    int MaxPacketBytes() const { return maxPacketSize; }  // Eth.MaxPacketSize
+
+    const char* Name() const override { return "generic"; }
+
+    // Encode the 14 symbols of one slot
+    void EncodeSlot(uint64_t frameId, int subframeId, int slotId, EncoderState& state, PacketBatch& batch) const override
+    {
+        batch.Reset(maxSlotBytes);
+        state.templates.resize(2 * streams.Count());
+
+        uint64_t slotInFrame = static_cast<uint64_t>(subframeId) * slotsPerSubframe + slotId;
+        uint64_t firstSymbol = (static_cast<uint64_t>(frameId) * 10 * slotsPerSubframe + slotInFrame) * 14;
+
+        for (int symbolId = 0; symbolId < 14; ++symbolId)
+        {
+            uint64_t symbolIndex = firstSymbol + symbolId;
+            uint64_t framesBefore = symbolIndex * framesPerSymbol;  // frames of each stream before this packet
+
+            for (int packetIndex = 0; packetIndex < static_cast<int>(layout.size()); ++packetIndex)
+            {
+                const PacketLayout& packet = layout[packetIndex];
+                for (size_t stream = 0; stream < streams.Count(); ++stream)
+                {
+                    const IQSampleStore* samples = streams.samples[stream];
+                    ORAN_Packet oranPacket;
+                    oranPacket.DestAddress = destAddress;
+                    oranPacket.SourceAddress = sourceAddress;
+                    oranPacket.FrameID = static_cast<uint8_t>(frameId & 0xFF);  // SFN modulo 256
+                    oranPacket.SubframeID = subframeId;
+                    oranPacket.SlotID = slotId;
+                    oranPacket.SymbolID = symbolId;
+                    oranPacket.compression = compression;
+                    oranPacket.eCPRI_PC_RTC = streams.eAxC[stream];
+                    std::vector<FrameTemplate>& packetTemplates = state.templates[2 * stream + (packet.numPrb == prbsPerPacket ? 0 : 1)];
+
+                    // Each fragment is a section of its own, encoded straight into the batch: ORAN, eCPRI and Ethernet
+                    // headers at their fixed offsets, IQ bytes copied once from a view of the sample buffer
+                    for (int fragmentIndex = 0; fragmentIndex < packet.fragments; ++fragmentIndex)
+                    {
+                        const SectionFragment& fragment = fragments[packet.firstFragment + fragmentIndex];
+                        oranPacket.startPrbu = fragment.startPrb;
+                        oranPacket.numPrbu = fragment.numPrb > 255 ? 0 : fragment.numPrb;  // 0 means all PRBs
+                        uint8_t seqId = static_cast<uint8_t>(streams.firstSeqId[stream] + framesBefore + fragmentIndex);
+                        uint8_t* frame = batch.bytes.data() + batch.used;
+                        size_t frameLength;
+                        if (streams.generator)
+                        {
+                            // built-in payload: generated in place, or next to the frame and compressed into it
+                            oranPacket.eCPRI_SeqId = seqId;
+                            uint8_t* payload = oranPacket.SectionPayload(frame);
+                            uint8_t* raw = payload;
+                            if (!compression.Legacy())
+                            {
+                                state.raw.resize(fragment.numPrb * IQSampleStore::BytesPerPRB);
+                                raw = state.raw.data();
+                            }
+                            streams.generator->Generate(raw, streams.eAxC[stream], symbolIndex, fragment.startPrb, fragment.numPrb,
+                                                        prbsPerSymbol);
+                            if (!compression.Legacy())
+                                compression.Compress(raw, fragment.numPrb, payload);
+                            frameLength = oranPacket.EncodeSection(frame, fragment.numPrb * compression.PRBBytes());
+                        }
+                        else if (useTemplates)
+                        {
+                            // the payload is the same for every packet: patch the pre-encoded frame of this fragment
+                            if (fragmentIndex == static_cast<int>(packetTemplates.size()))
+                            {
+                                packetTemplates.emplace_back();
+                                packetTemplates.back().Build(oranPacket, samples->View(fragment.iqOffset, fragment.numPrb * samples->PRBBytes()));
+                            }
+                            FrameTemplate& frameTemplate = packetTemplates[fragmentIndex];
+                            frameLength = frameTemplate.Length();
+                            std::memcpy(frame, frameTemplate.Patch(oranPacket, seqId), frameLength);
+                        }
+                        else
+                        {
+                            IQView iq = streamPayload ? samples->PRBView(symbolIndex, fragment.startPrb, fragment.numPrb, prbsPerSymbol)
+                                                      : samples->View(fragment.iqOffset, fragment.numPrb * samples->PRBBytes());
+                            oranPacket.eCPRI_SeqId = seqId;
+                            frameLength = oranPacket.EncodeFrame(frame, iq);
+                        }
+
+                        PacketBatch::Packet written = { batch.used, frameLength, 0, static_cast<int>(stream), symbolId, packetIndex,
+                                                        fragmentIndex, packet.fragments };
+                        batch.packets.push_back(written);
+                        batch.used += frameLength;
+                    }
+                }
+                framesBefore += packet.fragments;
+            }
+        }
+    }
+
+private:
+    StreamSet streams;
+    IQCompressor compression;
+    bool streamPayload;
+    bool useTemplates;
+    uint64_t destAddress, sourceAddress;
+    int slotsPerSubframe, prbsPerSymbol, prbsPerPacket, maxPacketSize;
+    std::vector<PacketLayout> layout;
+    std::vector<SectionFragment> fragments;   // split plan, every packet's sections in order
+    int framesPerSymbol;
+    size_t maxSlotBytes;
+};
+
+// Split plan of CaptureGenerator::Setup evaluated at compile time for one layout: MaxPrb PRBs per symbol in ORAN
+// packets of PrbsPerPacket PRBs, fixed-point IQ of IQWidth bits, Ethernet payloads of at most MaxPacketBytes
+template <int MaxPrb, int PrbsPerPacket, int IQWidth, int MaxPacketBytes>
+struct FixedPlan
+{
+    static constexpr bool Legacy = IQWidth == 16;  // uncompressed 16-bit, no udCompHdr
+    static constexpr size_t SectionHeaderSize = ORAN_Packet::HeaderSize + (Legacy ? 0 : ORAN_Packet::CompressionHeaderSize);
+    static constexpr size_t HeaderBytes = eCPRI_Packet::PayloadOffset + SectionHeaderSize;  // preamble/SFD up to the IQ
+    static constexpr size_t PRBBytes = 3 * IQWidth;
+    static constexpr size_t MaxECPRIPayload = 8191;  // eCPRI_Packet::MaxSupprotedPayload in whole bytes
+    static constexpr size_t MaxORANBytes = std::min<size_t>(MaxPacketBytes > static_cast<int>(eCPRI_Packet::HeaderSize)
+                                                            ? MaxPacketBytes - eCPRI_Packet::HeaderSize : 0, MaxECPRIPayload);
+    static constexpr int PrbsPerFragment = static_cast<int>(std::min<size_t>(MaxORANBytes > SectionHeaderSize
+                                                                             ? (MaxORANBytes - SectionHeaderSize) / PRBBytes : 0, 255));
+    static_assert(PrbsPerFragment > 0, "Eth.MaxPacketSize does not fit the section header and one PRB");
+    static constexpr int Packets = (MaxPrb + PrbsPerPacket - 1) / PrbsPerPacket;
+
+    struct Packet
+    {
+        int firstFragment;
+        int fragments;
+    };
+
+    struct Fragment
+    {
+        int startPrb;
+        int numPrb;
+        uint8_t numPrbu;       // 0 for a whole symbol of more than 255 PRBs
+        size_t iqOffset;
+        size_t payloadBytes;
+        size_t frameLength;
+    };
+
+    // PRBs of the packet starting at `prb`, and whether it stays one section with numPrbu 0
+    static constexpr int PacketPrbs(int prb) { return std::min(PrbsPerPacket, MaxPrb - prb); }
+    static constexpr bool Whole(int numPrb) { return numPrb == MaxPrb && SectionHeaderSize + numPrb * PRBBytes <= MaxORANBytes; }
+
+    static constexpr int CountFragments()
+    {
+        int count = 0;
+        for (int packet = 0, prb = 0; packet < Packets; ++packet, prb += PacketPrbs(prb))
+            count += Whole(PacketPrbs(prb)) ? 1 : (PacketPrbs(prb) + PrbsPerFragment - 1) / PrbsPerFragment;
+        return count;
+    }
+
+    static constexpr int FragmentCount = CountFragments();  // Ethernet frames per symbol and stream
+
+    struct Layout
+    {
+        std::array<Packet, Packets> packets;
+        std::array<Fragment, FragmentCount> fragments;
+        int maxFragmentPrbs;
+    };
+
+    static constexpr Layout MakeLayout()
+    {
+        Layout layout{};
+        int count = 0;
+        for (int packet = 0, prb = 0; packet < Packets; ++packet)
+        {
+            const int numPrb = PacketPrbs(prb);
+            layout.packets[packet].firstFragment = count;
+            for (int done = 0; done < numPrb; ++count)
+            {
+                Fragment& fragment = layout.fragments[count];
+                fragment.startPrb = prb + done;
+                fragment.numPrb = Whole(numPrb) ? numPrb : std::min(PrbsPerFragment, numPrb - done);
+                fragment.numPrbu = static_cast<uint8_t>(fragment.numPrb > 255 ? 0 : fragment.numPrb);
+                fragment.iqOffset = done * PRBBytes;
+                fragment.payloadBytes = fragment.numPrb * PRBBytes;
+                fragment.frameLength = HeaderBytes + fragment.payloadBytes + EthernetPacket::FCSSize;
+                layout.maxFragmentPrbs = std::max(layout.maxFragmentPrbs, fragment.numPrb);
+                done += fragment.numPrb;
+            }
+            layout.packets[packet].fragments = count - layout.packets[packet].firstFragment;
+            prb += numPrb;
+        }
+        return layout;
+    }
+
+    static constexpr Layout Split = MakeLayout();
+};
+
+// Slot encoder specialized at compile time on the numerology (Slots per subframe) and a FixedPlan layout
+// Every frame of a fragment and stream has the same bytes up to the IQ payload except the SeqId and the timing
+// fields, so a header image is encoded once per fragment and stream with the generic code. A packet is then a
+// constant-size header copy, four patched bytes, the IQ bytes and the FCS, over a split plan known to the compiler
+template <int Slots, int MaxPrb, int PrbsPerPacket, int IQWidth, int MaxPacketBytes>
+class FixedSlotEncoder : public SlotEncoder
+{
+    using Plan = FixedPlan<MaxPrb, PrbsPerPacket, IQWidth, MaxPacketBytes>;
+
+public:
+    // nullptr unless `generic` was set up with exactly this layout, e.g. a fixed-point IQ width the key does not cover
+    static std::unique_ptr<SlotEncoder> Create(const CaptureGenerator& generic)
+    {
+        const IQCompressor& compression = generic.Compression();
+        if (generic.UseTemplates() || generic.SlotsPerSubframe() != Slots || compression.Legacy() != Plan::Legacy || compression.PRBBytes() != Plan::PRBBytes ||
+            static_cast<int>(generic.Fragments().size()) != Plan::FragmentCount ||
+            static_cast<int>(generic.Layout().size()) != Plan::Packets)
+            return nullptr;
+        for (int f = 0; f < Plan::FragmentCount; ++f)
+        {
+            const SectionFragment& fragment = generic.Fragments()[f];
+            if (fragment.startPrb != Plan::Split.fragments[f].startPrb || fragment.numPrb != Plan::Split.fragments[f].numPrb ||
+                fragment.frameLength != Plan::Split.fragments[f].frameLength)
+                return nullptr;
+        }
+        return std::unique_ptr<SlotEncoder>(new FixedSlotEncoder(generic));
+    }
+
+    const char* Name() const override { return "specialized"; }
+
+    void EncodeSlot(uint64_t frameId, int subframeId, int slotId, EncoderState& state, PacketBatch& batch) const override
+    {
+        // one branch per slot on the payload source, none per packet
+        if (streams.generator)
+            Encode<Generated>(frameId, subframeId, slotId, state, batch);
+        else if (streamPayload)
+            Encode<Stream>(frameId, subframeId, slotId, state, batch);
+        else
+            Encode<Fixed>(frameId, subframeId, slotId, state, batch);
+    }
+
+private:
+    enum Source { Fixed, Stream, Generated };
+
+    static const size_t SeqIdOffset = EthernetPacket::PayloadOffset + 5;
+    static const size_t TimingOffset = eCPRI_Packet::PayloadOffset + 1;  // FrameID, SubframeID/SlotID, SlotID/SymbolID
+
+    using HeaderImage = std::array<uint8_t, Plan::HeaderBytes>;
+
+    explicit FixedSlotEncoder(const CaptureGenerator& generic)
+        : streams(generic.Streams()), compression(generic.Compression()), streamPayload(generic.StreamPayload()),
+          maxSlotBytes(generic.MaxSlotBytes()), headers(generic.Streams().Count() * Plan::FragmentCount)
+    {
+        std::vector<uint8_t> scratch(eCPRI_Packet::PayloadOffset + Plan::MaxORANBytes + EthernetPacket::FCSSize);
+        for (size_t stream = 0; stream < streams.Count(); ++stream)
+        {
+            for (int f = 0; f < Plan::FragmentCount; ++f)
+            {
+                ORAN_Packet prototype;
+                prototype.DestAddress = generic.DestAddress();
+                prototype.SourceAddress = generic.SourceAddress();
+                prototype.compression = compression;
+                prototype.eCPRI_PC_RTC = streams.eAxC[stream];
+                prototype.startPrbu = Plan::Split.fragments[f].startPrb;
+                prototype.numPrbu = Plan::Split.fragments[f].numPrbu;
+                prototype.EncodeSection(scratch.data(), Plan::Split.fragments[f].payloadBytes);
+                std::memcpy(headers[stream * Plan::FragmentCount + f].data(), scratch.data(), Plan::HeaderBytes);
+            }
+        }
+    }
+
+    template <Source source>
+    void Encode(uint64_t frameId, int subframeId, int slotId, EncoderState& state, PacketBatch& batch) const
+    {
+        batch.Reset(maxSlotBytes);
+        if (source == Generated && !Plan::Legacy)
+            state.raw.resize(Plan::Split.maxFragmentPrbs * IQSampleStore::BytesPerPRB);
+        const CRC32Engine::Variant crcVariant = CRC32Engine::Best();
+        const uint64_t firstSymbol = ((static_cast<uint64_t>(frameId) * 10 + subframeId) * Slots + slotId) * 14;
+
+        for (int symbolId = 0; symbolId < 14; ++symbolId)
+        {
+            const uint64_t symbolIndex = firstSymbol + symbolId;
+            const uint64_t framesBefore = symbolIndex * Plan::FragmentCount;
+            const uint8_t timing[3] = { static_cast<uint8_t>(frameId & 0xFF),
+                                        static_cast<uint8_t>((subframeId << 4) | ((slotId >> 2) & 0x0F)),
+                                        static_cast<uint8_t>(((slotId & 0x03) << 6) | (symbolId & 0x3F)) };
+
+            for (int packetIndex = 0; packetIndex < Plan::Packets; ++packetIndex)
+            {
+                const typename Plan::Packet& packet = Plan::Split.packets[packetIndex];
+                for (size_t stream = 0; stream < streams.Count(); ++stream)
+                {
+                    for (int f = packet.firstFragment; f < packet.firstFragment + packet.fragments; ++f)
+                    {
+                        const typename Plan::Fragment& fragment = Plan::Split.fragments[f];
+                        uint8_t* frame = batch.bytes.data() + batch.used;
+                        std::memcpy(frame, headers[stream * Plan::FragmentCount + f].data(), Plan::HeaderBytes);
+                        frame[SeqIdOffset] = static_cast<uint8_t>(streams.firstSeqId[stream] + framesBefore + f);
+                        std::memcpy(frame + TimingOffset, timing, sizeof(timing));
+
+                        uint8_t* payload = frame + Plan::HeaderBytes;
+                        if constexpr (source == Generated)
+                        {
+                            uint8_t* raw = Plan::Legacy ? payload : state.raw.data();
+                            streams.generator->Generate(raw, streams.eAxC[stream], symbolIndex, fragment.startPrb, fragment.numPrb, MaxPrb);
+                            if (!Plan::Legacy)
+                                compression.Compress(raw, fragment.numPrb, payload);
+                        }
+                        else if constexpr (source == Stream)
+                        {
+                            streams.samples[stream]->PRBView(symbolIndex, fragment.startPrb, fragment.numPrb, MaxPrb)
+                                .CopyTo(payload, 0, fragment.payloadBytes);
+                        }
+                        else
+                        {
+                            streams.samples[stream]->View(fragment.iqOffset, fragment.payloadBytes).CopyTo(payload, 0, fragment.payloadBytes);
+                        }
+
+                        const uint32_t fcs = ~CRC32Engine::UpdateRaw(0xFFFFFFFF, frame + EthernetPacket::PreambleSize,
+                                                                      Plan::HeaderBytes - EthernetPacket::PreambleSize + fragment.payloadBytes,
+                                                                      crcVariant);
+                        uint8_t* fcsBytes = payload + fragment.payloadBytes;
+                        for (int i = 0; i <= 3; ++i)
+                        {
+                            fcsBytes[i] = (fcs >> (i * 8)) & 0xFF;
+                        }
+
+                        PacketBatch::Packet written = { batch.used, fragment.frameLength, 0, static_cast<int>(stream), symbolId,
+                                                        packetIndex, f - packet.firstFragment, packet.fragments };
+                        batch.packets.push_back(written);
+                        batch.used += fragment.frameLength;
+                    }
+                }
+            }
+        }
+    }
+
+    StreamSet streams;
+    IQCompressor compression;
+    bool streamPayload;
+    size_t maxSlotBytes;
+    std::vector<HeaderImage> headers;  // per stream, per fragment of the plan
+};
+
+// Specialized pipelines of common production configurations, looked up from the setup file values; any other
+// configuration (and Gen.Mode=template, which patches pre-encoded frames instead) runs on the generic CaptureGenerator
+std::unique_ptr<SlotEncoder> CreateFixedSlotEncoder(const CaptureGenerator& generic)
+{
+    struct Entry
+    {
+        int slots, maxPrb, prbsPerPacket, iqWidth, maxPacketSize;
+        std::unique_ptr<SlotEncoder> (*create)(const CaptureGenerator&);
+    };
+    static const Entry entries[] = {
+        // 100 MHz at 30 kHz: the default setup, whole symbols in standard and jumbo frames, 9-bit fixed point
+        { 2, 273, 46, 16, 1500, &FixedSlotEncoder<2, 273, 46, 16, 1500>::Create },
+        { 2, 273, 273, 16, 1500, &FixedSlotEncoder<2, 273, 273, 16, 1500>::Create },
+        { 2, 273, 273, 16, 9000, &FixedSlotEncoder<2, 273, 273, 16, 9000>::Create },
+        { 2, 273, 273, 9, 9000, &FixedSlotEncoder<2, 273, 273, 9, 9000>::Create },
+        // 40 MHz at 30 kHz and 20 MHz at 15 kHz
+        { 2, 106, 106, 16, 9000, &FixedSlotEncoder<2, 106, 106, 16, 9000>::Create },
+        { 1, 106, 106, 16, 1500, &FixedSlotEncoder<1, 106, 106, 16, 1500>::Create },
+        { 1, 106, 106, 16, 9000, &FixedSlotEncoder<1, 106, 106, 16, 9000>::Create },
+    };
+    for (const Entry& entry : entries)
+    {
+        // Create() also checks the IQ width against the compression of `generic`
+        if (entry.slots == generic.SlotsPerSubframe() && entry.maxPrb == generic.PrbsPerSymbol() &&
+            entry.prbsPerPacket == generic.PrbsPerPacket() && entry.maxPacketSize == generic.MaxPacketBytes())
+        {
+            if (std::unique_ptr<SlotEncoder> encoder = entry.create(generic))
+                return encoder;
+        }
+    }
+    return nullptr;
+}
+
+// Transmission timeline of the capture at Eth.LineRate
+// Time is kept in bit times (1 / LineRate ns) so every start time is exact. A packet occupies the wire for its length
+// (preamble/SFD up to the FCS) plus EthernetPacket::GapIFGs. It starts as soon as the link is free, but not before
+//  - the start of its fill unit (symbol, slot or radio frame) if it is the first packet of the unit
+//  - the start of its burst if bursts are configured: BurstSize packets every BurstPeriodicity_us from the
+//    start of the capture
+// The idle time between the last packet of a unit and the start of the next unit is the unit's IFG fill
+class PacketScheduler
+{
+public:
+    enum FillUnit { Symbol, Slot, Frame };
+
+    static bool ParseFillUnit(const std::string& name, FillUnit& unit)
+    {
+        if (name == "symbol")
+            unit = Symbol;
+        else if (name == "slot")
+            unit = Slot;
+        else if (name == "frame")
+            unit = Frame;
+        else
+            return false;
+        return true;
+    }
+
+    // False for a line rate below 1 Gbit/s or a negative IFG count, which the timeline cannot place packets with
+    bool Configure(int lineRateGbps, int minIFGs, int burstSize, int burstPeriodUs, FillUnit unit, int slotsPerSubframe)
+    {
+        if (lineRateGbps < 1 || minIFGs < 0)
+            return false;
+        bitsPerNs = lineRateGbps;
+        this->minIFGs = minIFGs;
+        this->burstSize = burstSize > 0 && burstPeriodUs > 0 ? burstSize : 0;
+        burstPeriodBits = static_cast<uint64_t>(burstPeriodUs) * 1000 * bitsPerNs;
+        fillUnit = unit;
+        slotsPerSubframe_ = slotsPerSubframe;
+        linkFree = 0;
+        origin = 0;
+        unitStart = 0;
+        firstOfUnit = true;
+        scheduled = 0;
+        busyBits = gapBits = fillBits = 0;
+        overruns = 0;
+        return true;
+    }
+
+    FillUnit Unit() const { return fillUnit; }
+
+    // Start the timeline at radio frame `frameId` instead of the start of the capture, as a shard does, in the state a
+    // run from frame 0 reaches there. `symbolFrames` holds the frame lengths of one symbol in output order; every
+    // symbol has the same ones. IFG fill never delays a later packet, so a packet starts at the latest of the end of
+    // the one before and its anchors (the start of its unit if it opens one, of its burst if it opens one), and the
+    // link is free at C + max over anchors j of (anchor - C(j)), C(j) being the wire bits of the packets before j.
+    // That term is linear in the frame for unit starts and periodic, plus a linear term, for burst starts (the
+    // bursts line up with the frames again every P / gcd(P, BurstSize) bursts), so only the first and last
+    // occurrence of each needs to be looked at
+    void Seek(uint64_t frameId, const std::vector<size_t>& symbolFrames)
+    {
+        const uint64_t symbolsPerFrame = 14ull * 10 * slotsPerSubframe_;
+        std::vector<uint64_t> before(symbolFrames.size() + 1, 0);  // wire bits within a symbol up to each packet
+        for (size_t i = 0; i < symbolFrames.size(); ++i)
+        {
+            before[i + 1] = before[i] + (symbolFrames[i] + EthernetPacket::GapIFGs(symbolFrames[i], minIFGs)) * 8;
+        }
+        const uint64_t perSymbol = symbolFrames.size();
+        const uint64_t packetsPerFrame = perSymbol * symbolsPerFrame;
+        auto wireBefore = [&](uint64_t packet) { return packet / perSymbol * before.back() + before[packet % perSymbol]; };
+
+        origin = FrameStartBits(frameId);
+        linkFree = origin;
+        scheduled = frameId * packetsPerFrame;
+        if (frameId == 0 || perSymbol == 0)
+            return;
+
+        const uint64_t end = scheduled;  // the packets of frames [0, frameId)
+        int64_t latest = INT64_MIN;
+        auto anchor = [&](uint64_t bits, uint64_t packet)
+        {
+            latest = std::max(latest, static_cast<int64_t>(bits - wireBefore(packet)));
+        };
+        const uint64_t units = fillUnit == Symbol ? symbolsPerFrame : fillUnit == Slot ? 10ull * slotsPerSubframe_ : 1;
+        for (uint64_t frame : { uint64_t(0), frameId - 1 })
+        {
+            for (uint64_t unit = 0; unit < units; ++unit)
+            {
+                const int slotInFrame = static_cast<int>(fillUnit == Symbol ? unit / 14 : unit);
+                const int symbolId = static_cast<int>(fillUnit == Symbol ? unit % 14 : 0);
+                anchor(UnitStartBits(frame, slotInFrame, symbolId), frame * packetsPerFrame + unit * (packetsPerFrame / units));
+            }
+        }
+        if (burstSize != 0)
+        {
+            const uint64_t bursts = (end + burstSize - 1) / burstSize;
+            const uint64_t period = packetsPerFrame / std::gcd(packetsPerFrame, static_cast<uint64_t>(burstSize));
+            for (uint64_t first = 0; first < std::min(period, bursts); ++first)
+            {
+                const uint64_t last = first + (bursts - 1 - first) / period * period;
+                anchor(first * burstPeriodBits, first * burstSize);
+                anchor(last * burstPeriodBits, last * burstSize);
+            }
+        }
+        linkFree = std::max(origin, static_cast<uint64_t>(static_cast<int64_t>(wireBefore(end)) + latest));
+    }
+
+    // Nominal start of a symbol, slot or radio frame in bit times; symbols and slots divide the 1 ms subframe evenly.
+    // The offset within the frame is added to the frame start so the products stay small however long the run
+    uint64_t UnitStartBits(uint64_t frameId, int slotInFrame, int symbolId) const
+    {
+        const uint64_t subframeBits = 1000000ull * bitsPerNs;
+        switch (fillUnit)
+        {
+        case Symbol:
+            return FrameStartBits(frameId) + static_cast<uint64_t>(slotInFrame * 14 + symbolId) * subframeBits / (slotsPerSubframe_ * 14);
+        case Slot:
+            return FrameStartBits(frameId) + static_cast<uint64_t>(slotInFrame) * subframeBits / slotsPerSubframe_;
+        default:
+            return FrameStartBits(frameId);
+        }
+    }
+
+    uint64_t FrameStartBits(uint64_t frameId) const { return frameId * 10 * 1000000ull * bitsPerNs; }
+
+    // Start a fill unit at `startBits`
+    void BeginUnit(uint64_t startBits)
+    {
+        unitStart = startBits;
+        firstOfUnit = true;
+    }
+
+    // Reserve the wire for a packet and return its start time in ns
+    uint64_t Schedule(size_t packetLength)
+    {
+        uint64_t start = linkFree;
+        if (firstOfUnit)
+        {
+            start = std::max(start, unitStart);
+            firstOfUnit = false;
+        }
+        if (burstSize != 0 && scheduled % burstSize == 0)
+        {
+            start = std::max(start, scheduled / burstSize * burstPeriodBits);
+        }
+        ++scheduled;
+
+        uint64_t packetBits = packetLength * 8;
+        uint64_t gap = EthernetPacket::GapIFGs(packetLength, minIFGs) * 8;
+        busyBits += packetBits;
+        gapBits += gap;
+        linkFree = start + packetBits + gap;
+        return start / bitsPerNs;
+    }
+
+    // End the current unit; the next one starts at `nextStartBits`. Returns the IFG bytes filling the idle time
+    // (0 and one overrun more if the packets of the unit did not fit)
+    uint64_t EndUnit(uint64_t nextStartBits)
+    {
+        if (linkFree > nextStartBits)
+        {
+            ++overruns;
+            return 0;
+        }
+        uint64_t fill = (nextStartBits - linkFree) / 8;
+        fillBits += fill * 8;
+        linkFree += fill * 8;
+        return fill;
+    }
+
+    // Schedule a packet of a slot batch, slot `slotInFrame` of radio frame `frameId`, in output order: its first packet
+    // of a fill unit starts the unit and its last one ends it. Returns the start time in ns; `fill` is set to the IFG
+    // bytes filling the idle time after the packet and `endsUnit` tells whether the packet closed its unit
+    uint64_t SchedulePacket(const PacketBatch::Packet& packet, uint64_t frameId, int slotInFrame, int slotsPerFrame,
+                            int packetsPerSymbol, int lastStream, uint64_t& fill, bool& endsUnit)
+    {
+        // A fill unit starts with the first packet of its first symbol, of the first stream
+        int symbolId = packet.symbolId;
+        bool lastSymbolOfSlot = symbolId == 13;
+        bool lastSlotOfFrame = slotInFrame + 1 == slotsPerFrame;
+        if (packet.packetIndex == 0 && packet.stream == 0 && packet.fragmentIndex == 0 &&
+            (fillUnit == Symbol || symbolId == 0) && (fillUnit != Frame || slotInFrame == 0))
+        {
+            BeginUnit(UnitStartBits(frameId, slotInFrame, symbolId));
+        }
+        uint64_t timestampNs = Schedule(packet.length);
+
+        // The idle time up to the next unit is filled with IFGs
+        endsUnit = packet.packetIndex + 1 == packetsPerSymbol && packet.stream == lastStream && packet.fragmentIndex + 1 == packet.fragmentCount &&
+                   (fillUnit == Symbol || lastSymbolOfSlot) && (fillUnit != Frame || lastSlotOfFrame);
+        fill = 0;
+        if (endsUnit)
+        {
+            uint64_t nextStart = fillUnit == Symbol ? UnitStartBits(frameId, slotInFrame, symbolId + 1)
+                               : fillUnit == Slot ? UnitStartBits(frameId, slotInFrame + 1, 0)
+                               : UnitStartBits(frameId + 1, 0, 0);
+            fill = EndUnit(nextStart);
+        }
+        return timestampNs;
+    }
+
+    uint64_t Overruns() const { return overruns; }
+    uint64_t EndNs() const { return linkFree / bitsPerNs; }
+    uint64_t DurationNs() const { return (linkFree - origin) / bitsPerNs; }  // since the start of the timeline
+    uint64_t PacketBytes() const { return busyBits / 8; }
+    uint64_t GapBytes() const { return gapBits / 8; }
+    uint64_t FillBytes() const { return fillBits / 8; }
+
+    // Share of the timeline carrying packets (preamble/SFD up to the FCS), IFGs excluded
+    double LinkUtilization() const { return linkFree > origin ? static_cast<double>(busyBits) / (linkFree - origin) : 0; }
+
+private:
+    uint64_t bitsPerNs = 1;
+    int minIFGs = 0;
+    int burstSize = 0;
+    uint64_t burstPeriodBits = 0;
+    FillUnit fillUnit = Frame;
+    int slotsPerSubframe_ = 1;
+    uint64_t linkFree = 0;       // first bit time at which the wire is free
+    uint64_t origin = 0;         // start of the timeline, after Seek
+    uint64_t unitStart = 0;
+    bool firstOfUnit = true;
+    uint64_t scheduled = 0;
+    uint64_t busyBits = 0, gapBits = 0, fillBits = 0;
+    uint64_t overruns = 0;
+};
+
+// Load of one configuration per 10 ms radio frame, in closed form without encoding a packet: the split plan of
+// CaptureGenerator::Setup (ORAN packets of ORAN.NRBperpacket PRBs, fragmented to fit Eth.MaxPacketSize) and the
+// timeline rules of PacketScheduler (IFG gaps, the idle time of every fill unit filled with IFGs). The results are
+// exact for every setting the generator accepts: a run of F radio frames without overruns writes F times the
+// packet, gap and fill bytes. Bursts are only checked as a rate limit: where they delay packets on the timeline is
+// not modeled, so with bursts the fill bytes, utilization, occupancy and headroom are not planned (Bursts())
+struct CapacityPlan
+{
+    // Settings, as the setup file keys
+    int scs = 30, maxNrb = 273, nrbPerPacket = 273, maxPacketSize = 1500;
+    int lineRate = 10;                 // Gbit/s
+    int streams = 1;                   // eAxC streams
+    int minIFGs = 1;
+    IQCompressor compression;
+    PacketScheduler::FillUnit fillUnit = PacketScheduler::Frame;
+    int burstSize = 0, burstPeriodUs = 0;
+
+    // Results, per radio frame unless said otherwise; Evaluate() is false and `valid` unset if a single PRB does
+    // not fit Eth.MaxPacketSize or a setting is out of range
+    bool valid = false;
+    int slotsPerSubframe = 0;
+    int packetsPerSymbol = 0;          // ORAN packets per symbol and stream
+    int framesPerSymbol = 0;           // Ethernet frames per symbol and stream
+    int prbsPerFragment = 0;           // PRBs of a full fragment
+    uint64_t ethernetFrames = 0, oranPackets = 0, fragmentedPackets = 0;
+    uint64_t packetBytes = 0;          // preamble/SFD up to the FCS
+    uint64_t gapBytes = 0;             // IFGs after every packet (Eth.MinNumOfIFGsPerPacket, realigned to 4 bytes)
+    uint64_t fillBytes = 0;            // IFGs filling the idle time of the fill units that fit
+    uint64_t frameBits = 0;            // capacity of the link over 10 ms
+    uint64_t unitBytes = 0;            // packet and gap bytes of one fill unit
+    uint64_t unitBitsMin = 0;          // shortest fill unit on the timeline
+    uint64_t overrunUnits = 0;         // fill units whose packets do not fit them
+    int minLineRate = 0;               // lowest Eth.LineRate without overruns
+    double burstUs = 0;                // time the bursts (Eth.BurstSize per Eth.BurstPeriodicity_us) need for the frame
+
+    bool Bursts() const { return burstSize > 0 && burstPeriodUs > 0; }
+    bool BurstLimited() const { return burstUs > 10000; }
+    bool Fits() const { return valid && overrunUnits == 0 && !BurstLimited(); }
+    double LinkUtilization() const { return frameBits ? packetBytes * 8.0 / frameBits : 0; }            // as PacketScheduler
+    double Occupancy() const { return frameBits ? (packetBytes + gapBytes) * 8.0 / frameBits : 0; }      // gaps included
+    double Headroom() const { return unitBitsMin ? 1 - unitBytes * 8.0 / unitBitsMin : 0; }             // of the fullest unit
+
+    bool Evaluate()
+    {
+        static const size_t maxECPRIPayload = static_cast<size_t>(eCPRI_Packet().MaxSupprotedPayload);
+        valid = false;
+        ethernetFrames = oranPackets = fragmentedPackets = packetBytes = gapBytes = fillBytes = 0;
+        overrunUnits = 0;
+        burstUs = 0;
+        slotsPerSubframe = scs == 15 ? 1 : scs == 30 ? 2 : scs == 60 ? 4 : 0;
+        if (slotsPerSubframe == 0 || maxNrb < 1 || nrbPerPacket < 1 || streams < 1 || lineRate < 1)
+            return false;
+
+        // the split plan, as CaptureGenerator::Setup builds it
+        const size_t headerSize = ORAN_Packet::HeaderSize + (compression.Legacy() ? 0 : ORAN_Packet::CompressionHeaderSize);
+        const size_t prbBytes = compression.PRBBytes();
+        const size_t maxORANBytes = std::min(maxPacketSize > static_cast<int>(eCPRI_Packet::HeaderSize) ? maxPacketSize - eCPRI_Packet::HeaderSize : 0,
+                                             maxECPRIPayload);
+        prbsPerFragment = static_cast<int>(std::min<size_t>(maxORANBytes > headerSize ? (maxORANBytes - headerSize) / prbBytes : 0, 255));
+        if (prbsPerFragment == 0)
+            return false;
+        packetsPerSymbol = (maxNrb + nrbPerPacket - 1) / nrbPerPacket;
+        const int fullPrbs = std::min(nrbPerPacket, maxNrb);
+        const int lastPrbs = maxNrb - (packetsPerSymbol - 1) * fullPrbs;
+
+        // `count` packets of `prbs` PRBs: whole fragments and a shorter last one
+        uint64_t frames = 0, fragmented = 0, packets = 0, gaps = 0;
+        auto addPackets = [&](int prbs, uint64_t count)
+        {
+            const bool whole = prbs == maxNrb && headerSize + prbs * prbBytes <= maxORANBytes;
+            const int full = whole ? 1 : prbs / prbsPerFragment;
+            const int fullSize = whole ? prbs : prbsPerFragment;
+            const int rest = whole ? 0 : prbs % prbsPerFragment;
+            const size_t fullLength = eCPRI_Packet::PayloadOffset + headerSize + fullSize * prbBytes + EthernetPacket::FCSSize;
+            const size_t restLength = eCPRI_Packet::PayloadOffset + headerSize + rest * prbBytes + EthernetPacket::FCSSize;
+            const uint64_t fragments = full + (rest > 0);
+            frames += count * fragments;
+            fragmented += fragments > 1 ? count : 0;
+            packets += count * (full * fullLength + (rest > 0 ? restLength : 0));
+            gaps += count * (full * EthernetPacket::GapIFGs(fullLength, minIFGs) + (rest > 0 ? EthernetPacket::GapIFGs(restLength, minIFGs) : 0));
+        };
+        addPackets(fullPrbs, packetsPerSymbol - 1);
+        addPackets(lastPrbs, 1);
+        framesPerSymbol = static_cast<int>(frames);
+
+        const uint64_t symbolsPerFrame = 14ull * 10 * slotsPerSubframe;
+        const uint64_t perFrame = symbolsPerFrame * streams;
+        ethernetFrames = frames * perFrame;
+        oranPackets = static_cast<uint64_t>(packetsPerSymbol) * perFrame;
+        fragmentedPackets = fragmented * perFrame;
+        packetBytes = packets * perFrame;
+        gapBytes = gaps * perFrame;
+
+        // Fill units divide the frame evenly in bit times: unit j of U starts at floor(j * frameBits / U), so
+        // c of them are one bit longer than the others (PacketScheduler::UnitStartBits). A unit fits if its packet
+        // and gap bits do; the idle bytes left are filled with IFGs
+        const uint64_t units = fillUnit == PacketScheduler::Symbol ? symbolsPerFrame
+                             : fillUnit == PacketScheduler::Slot ? 10ull * slotsPerSubframe : 1;
+        frameBits = 10000000ull * lineRate;
+        unitBytes = (packets + gaps) * streams * (symbolsPerFrame / units);
+        unitBitsMin = frameBits / units;
+        const uint64_t longUnits = frameBits - units * unitBitsMin;
+        const uint64_t unitBits = unitBytes * 8;
+        if (unitBits <= unitBitsMin)
+            fillBytes = (units - longUnits) * (unitBitsMin / 8 - unitBytes) + longUnits * ((unitBitsMin + 1) / 8 - unitBytes);
+        else if (unitBits == unitBitsMin + 1)
+            fillBytes = longUnits * ((unitBitsMin + 1) / 8 - unitBytes);
+        overrunUnits = unitBits <= unitBitsMin ? 0 : unitBits == unitBitsMin + 1 ? units - longUnits : units;
+        minLineRate = static_cast<int>(std::max<uint64_t>(1, (unitBits * units + 9999999) / 10000000));
+
+        if (Bursts())
+            burstUs = static_cast<double>(ethernetFrames) * burstPeriodUs / burstSize;
+        valid = true;
+        return true;
+    }
+};
+
+// Remaining time of a radio frame after its packets and gaps, and the IFG bytes filling it, for the settings of
+// the setup file (CapacityPlan); `bursts` is set if bursts are configured, and then neither is planned
+bool PlanFrameBudget(double& remainingSeconds, int& fillIFGs, bool& bursts)
+{
+    CapacityPlan plan;
+    std::vector<uint8_t> eAxCIds;
+    if (!IQCompressor::Parse(oran_compMethod, oran_iqWidth, plan.compression) || !StreamSet::ParseIds(oran_eAxC, eAxCIds) ||
+        !PacketScheduler::ParseFillUnit(eth_ifgFill, plan.fillUnit))
+        return false;
+    plan.scs = oran_scs;
+    plan.maxNrb = static_cast<int>(oran_Maxprb);
+    plan.nrbPerPacket = static_cast<int>(oran_nrbPerPacket);
+    plan.maxPacketSize = MaxPacketSize;
+    plan.lineRate = LineRate;
+    plan.streams = static_cast<int>(eAxCIds.size());
+    plan.minIFGs = MinNumOfIFGsPerPacket;
+    plan.burstSize = BurstSize;
+    plan.burstPeriodUs = BurstPeriodicity;
+    if (!plan.Evaluate())
+        return false;
+    bursts = plan.Bursts();
+    remainingSeconds = (static_cast<double>(plan.frameBits) - (plan.packetBytes + plan.gapBytes) * 8.0) / (LineRate * 1e9);
+    fillIFGs = static_cast<int>(plan.fillBytes);
+    return true;
+}
+
+// One Ethernet frame handed out by PacketGenerator::NextBatch, with its place in the capture
+struct FrameSlot
+{
+    uint8_t* buffer = nullptr;      // caller's memory the frame is copied to; nullptr: no copy, `frame` points into
+                                    // the generator and stays valid until the next NextBatch call
+    size_t capacity = 0;            // bytes at `buffer`
+
+    const uint8_t* frame = nullptr; // preamble/SFD up to the FCS
+    size_t length = 0;
+    uint64_t timestampNs = 0;       // start on the wire
+    uint64_t ifgsAfter = 0;         // IFG bytes up to the next frame: the gap after it and any idle-time fill
+    uint64_t frameId = 0;           // radio frames since the start of the capture; the FrameID field is its low byte
+    int subframeId = 0, slotId = 0, symbolId = 0;
+    int startPrb = 0, numPrb = 0;   // PRBs of the section; its numPrbu field is 0 for a whole symbol of 256+ PRBs
+    uint8_t eAxC = 0, seqId = 0;
+    int fragmentIndex = 0, fragmentCount = 0;  // section within its ORAN packet
+};
+
+// The generator as a library: built from a GeneratorConfig (a setup file or code), it reads the IQ payload files and
+// sets up the slot encoder and the timeline, without the globals. The caller then pulls the capture frame by frame
+// with NextBatch on its own thread, e.g. straight into a simulator or a NIC ring; main() uses the same setup and
+// encodes the slots on its thread pool
+class PacketGenerator
+{
+public:
+    PacketGenerator() = default;
+    PacketGenerator(const PacketGenerator&) = delete;
+    PacketGenerator& operator=(const PacketGenerator&) = delete;
+
+    // False with a message in `error` if the configuration is invalid or a payload file cannot be read
+    bool Open(const GeneratorConfig& config, std::string& error)
+    {
+        slotsPerSubframe = config.scs == 15 ? 1 : config.scs == 30 ? 2 : config.scs == 60 ? 4 : 0;
+        if (slotsPerSubframe == 0)
+        {
+            error = "Invalid ORAN SCS value: " + std::to_string(config.scs);
+            return false;
+        }
+        if (config.maxNrb < 1 || config.maxNrb > 273)
+        {
+            error = "Invalid ORAN.MaxNRB: " + std::to_string(config.maxNrb) + " (expected 1-273)";
+            return false;
+        }
+        if (config.lineRate < 1)
+        {
+            error = "Invalid Eth.LineRate: " + std::to_string(config.lineRate) + " (expected 1 Gbit/s or more)";
+            return false;
+        }
+        if (config.outputRingMb < 0)
+        {
+            error = "Invalid Output.RingSizeMB: " + std::to_string(config.outputRingMb) + " (expected 0 or more)";
+            return false;
+        }
+
+        // fixed: every packet carries the first samples of the IQ file (looping over the file if it is too short)
+        // stream: every packet carries the samples of its own symbol and PRBs, the file being a sequence of symbols
+        // random, qpsk, qam16, qam64, qam256, tone, pattern: generated samples, no IQ file is read
+        const std::string payloadType = config.payloadType.empty() ? "fixed" : config.payloadType;
+        if (payloadType == "tone" && config.tonePeriod < 1)
+        {
+            error = "Invalid ORAN.TonePeriod: " + std::to_string(config.tonePeriod) + " (expected 1 or more)";
+            return false;
+        }
+        bool generatedPayload = IQPayloadGenerator::Parse(payloadType, config.payloadSeed, config.tonePeriod, payloadGenerator);
+        if (payloadType != "fixed" && payloadType != "stream" && !generatedPayload)
+        {
+            error = "Unknown ORAN payload type: " + payloadType;
+            return false;
+        }
+        bool streamPayload = payloadType != "fixed";
+
+        IQCompressor compression;
+        if (!IQCompressor::Parse(config.compMethod, config.iqWidth, compression))
+        {
+            error = "Unsupported IQ compression: " + config.compMethod + " at " + std::to_string(config.iqWidth) + " bits";
+            return false;
+        }
+
+        std::vector<uint8_t> eAxCIds;
+        if (!StreamSet::ParseIds(config.eAxC, eAxCIds))
+        {
+            error = "Invalid eAxC list: " + config.eAxC + " (expected distinct IDs 0-255)";
+            return false;
+        }
+
+        // Streams reading the same file share its samples
+        std::vector<std::string> iqFilePaths = config.PayloadFiles();
+        iqStores.clear();
+        iqStores.resize(iqFilePaths.size());
+        StreamSet streams;
+        if (generatedPayload)
+        {
+            streams.generator = &payloadGenerator;
+        }
+        for (size_t stream = 0; stream < eAxCIds.size(); ++stream)
+        {
+            if (generatedPayload)
+            {
+                streams.Add(eAxCIds[stream], config.seqId, nullptr);
+                continue;
+            }
+            size_t file = std::min(stream, iqFilePaths.size() - 1);
+            size_t shared = std::find(iqFilePaths.begin(), iqFilePaths.end(), iqFilePaths[file]) - iqFilePaths.begin();
+            if (!iqStores[shared])
+            {
+                iqStores[shared].reset(new IQSampleStore);
+                if (!iqStores[shared]->Open(iqFilePaths[shared]) || !iqStores[shared]->Compress(compression))
+                {
+                    error = "Error generating ORAN payload.";
+                    return false;
+                }
+            }
+            streams.Add(eAxCIds[stream], config.seqId, iqStores[shared].get());
+        }
+
+        // Template mode: one pre-encoded frame per fragment of the payload, patched for every packet
+        if (config.mode != "encode" && config.mode != "template")
+        {
+            error = "Unknown generation mode: " + config.mode;
+            return false;
+        }
+        bool useTemplates = config.mode == "template" && !streamPayload;
+        if (!generic.Setup(streams, streamPayload, useTemplates, macAddressToUInt64(config.destAddress),
+                           macAddressToUInt64(config.sourceAddress), compression, slotsPerSubframe, config.maxNrb,
+                           config.nrbPerPacket, config.maxPacketSize))
+        {
+            // Setup fails for a packet of no PRBs, or a frame too small for the section header and one PRB
+            if (config.nrbPerPacket < 1)
+                error = "Invalid ORAN.NRBperpacket: " + std::to_string(config.nrbPerPacket) + " (expected 1 or more)";
+            else
+                error = "Eth.MaxPacketSize " + std::to_string(config.maxPacketSize) + " does not fit the section header and one PRB.";
+            return false;
+        }
+
+        // A specialized pipeline for the setup if there is one, the generic encoder otherwise
+        if (config.pipeline != "auto" && config.pipeline != "generic")
+        {
+            error = "Unknown pipeline: " + config.pipeline;
+            return false;
+        }
+        specialized.reset();
+        if (config.pipeline == "auto")
+        {
+            specialized = CreateFixedSlotEncoder(generic);
+        }
+
+        // Timestamps and IFG fill follow the packets in output order
+        PacketScheduler::FillUnit fillUnit;
+        if (!PacketScheduler::ParseFillUnit(config.ifgFill, fillUnit))
+        {
+            error = "Unknown IFG fill unit: " + config.ifgFill;
+            return false;
+        }
+        if (!scheduler.Configure(config.lineRate, config.minIFGsPerPacket, config.burstSize, config.burstPeriodicityUs,
+                                 fillUnit, slotsPerSubframe))
+        {
+            error = "Invalid Eth.MinNumOfIFGsPerPacket: " + std::to_string(config.minIFGsPerPacket) + " (expected 0 or more)";
+            return false;
+        }
+        minIFGs = config.minIFGsPerPacket;
+
+        // Gen.Shard=i/N: radio frames [i F / N, (i + 1) F / N) of the F frames of the capture
+        char shardEnd = 0;
+        if (std::sscanf(config.shard.c_str(), "%d/%d%c", &shardIndex, &shardCount, &shardEnd) != 2 || shardCount < 1 ||
+            shardIndex < 0 || shardIndex >= shardCount)
+        {
+            error = "Invalid shard: " + config.shard + " (expected i/N with 0 <= i < N)";
+            return false;
+        }
+        // Gen.Continuous=1: no end, the caller stops pulling
+        continuous = config.continuous != 0;
+        if (continuous && shardCount > 1)
+        {
+            error = "Gen.Continuous cannot be combined with Gen.Shard.";
+            return false;
+        }
+        if (!continuous && config.captureSizeMs < 10)
+        {
+            error = "Invalid Eth.CaptureSizeMs: " + std::to_string(config.captureSizeMs) + " (expected 10 ms or more, one radio frame)";
+            return false;
+        }
+        const uint64_t radioFrames = config.captureSizeMs > 0 ? config.captureSizeMs / 10 : 0;
+        firstFrame = radioFrames * shardIndex / shardCount;
+        endFrame = continuous ? UINT64_MAX / 2 / SlotsPerFrame() : radioFrames * (shardIndex + 1) / shardCount;
+        std::vector<size_t> symbolFrames;  // in output order: ORAN packet k of every stream, then packet k + 1
+        for (const PacketLayout& packet : generic.Layout())
+        {
+            for (size_t stream = 0; stream < streams.Count(); ++stream)
+            {
+                for (int f = 0; f < packet.fragments; ++f)
+                {
+                    symbolFrames.push_back(generic.Fragments()[packet.firstFragment + f].frameLength);
+                }
+            }
+        }
+        scheduler.Seek(firstFrame, symbolFrames);
+
+        nextSlot = firstFrame * SlotsPerFrame();
+        endSlot = endFrame * SlotsPerFrame();
+        batch.packets.clear();
+        cursor = 0;
+        return true;
+    }
+
+    // Fill `frames` with the next frames of the capture in output order, encoding slots as needed. Returns the
+    // number of frames filled, less than frames.size() at the end of the capture (see Done()), at a FrameSlot whose
+    // buffer is too small (its `length` is then set to the bytes needed), or at the end of a slot once frames without
+    // a buffer were handed out, since encoding the next slot would overwrite them
+    size_t NextBatch(std::span<FrameSlot> frames)
+    {
+        size_t filled = 0;
+        bool viewed = false;
+        while (filled < frames.size())
+        {
+            if (cursor == batch.packets.size())
+            {
+                if (nextSlot == endSlot || viewed)
+                    break;
+                EncodeNextSlot();
+            }
+            const PacketBatch::Packet& packet = batch.packets[cursor];
+            const uint8_t* frame = batch.bytes.data() + packet.offset;
+            FrameSlot& out = frames[filled];
+            out.length = packet.length;
+            if (out.buffer)
+            {
+                if (out.capacity < packet.length)
+                    break;
+                std::memcpy(out.buffer, frame, packet.length);
+                out.frame = out.buffer;
+            }
+            else
+            {
+                out.frame = frame;
+                viewed = true;
+            }
+
+            const SectionFragment& fragment = generic.Fragments()[generic.Layout()[packet.packetIndex].firstFragment + packet.fragmentIndex];
+            out.timestampNs = packet.timestampNs;
+            out.ifgsAfter = ifgsAfter[cursor];
+            out.frameId = slotFrameId;
+            out.subframeId = slotSubframeId;
+            out.slotId = slotId;
+            out.symbolId = packet.symbolId;
+            out.startPrb = fragment.startPrb;
+            out.numPrb = fragment.numPrb;
+            out.eAxC = generic.Streams().eAxC[packet.stream];
+            out.seqId = frame[EthernetPacket::PayloadOffset + 5];
+            out.fragmentIndex = packet.fragmentIndex;
+            out.fragmentCount = packet.fragmentCount;
+            ++cursor;
+            ++filled;
+        }
+        return filled;
+    }
+
+    bool Done() const { return cursor == batch.packets.size() && nextSlot == endSlot; }  // never in a continuous run
+
+    // Buffer size that holds any frame of the capture
+    size_t MaxFrameLength() const
+    {
+        size_t longest = 0;
+        for (const SectionFragment& fragment : generic.Fragments())
+            longest = std::max(longest, fragment.frameLength);
+        return longest;
+    }
+
+    const CaptureGenerator& Generic() const { return generic; }
+    const SlotEncoder& Encoder() const { return specialized ? *specialized : static_cast<const SlotEncoder&>(generic); }
+    PacketScheduler& Scheduler() { return scheduler; }
+    int SlotsPerSubframe() const { return slotsPerSubframe; }
+    int SlotsPerFrame() const { return 10 * slotsPerSubframe; }
+    int ShardIndex() const { return shardIndex; }
+    int ShardCount() const { return shardCount; }
+    uint64_t FirstFrame() const { return firstFrame; }   // radio frames [FirstFrame, EndFrame) of the shard
+    uint64_t EndFrame() const { return endFrame; }       // far beyond any run when Continuous()
+    bool Continuous() const { return continuous; }
+
+private:
+    // Encode slot `nextSlot` and place its packets on the timeline
+    void EncodeNextSlot()
+    {
+        slotFrameId = nextSlot / SlotsPerFrame();
+        const int slotInFrame = static_cast<int>(nextSlot % SlotsPerFrame());
+        slotSubframeId = slotInFrame / slotsPerSubframe;
+        slotId = slotInFrame % slotsPerSubframe;
+        Encoder().EncodeSlot(slotFrameId, slotSubframeId, slotId, state, batch);
+
+        const int packetsPerSymbol = static_cast<int>(generic.Layout().size());
+        const int lastStream = static_cast<int>(generic.StreamCount()) - 1;
+        ifgsAfter.resize(batch.packets.size());
+        for (size_t p = 0; p < batch.packets.size(); ++p)
+        {
+            PacketBatch::Packet& packet = batch.packets[p];
+            uint64_t fill;
+            bool endsUnit;
+            packet.timestampNs = scheduler.SchedulePacket(packet, slotFrameId, slotInFrame, SlotsPerFrame(), packetsPerSymbol,
+                                                          lastStream, fill, endsUnit);
+            ifgsAfter[p] = EthernetPacket::GapIFGs(packet.length, minIFGs) + fill;
+        }
+        ++nextSlot;
+        cursor = 0;
+    }
+
+    IQPayloadGenerator payloadGenerator;
+    std::vector<std::unique_ptr<IQSampleStore>> iqStores;
+    CaptureGenerator generic;
+    std::unique_ptr<SlotEncoder> specialized;
+    PacketScheduler scheduler;
+    int slotsPerSubframe = 1;
+    int minIFGs = 0;
+    int shardIndex = 0, shardCount = 1;
+    uint64_t firstFrame = 0, endFrame = 0;
+    bool continuous = false;
+
+    // pull state: the encoded slot and the next frame to hand out
+    EncoderState state;
+    PacketBatch batch;
+    std::vector<uint64_t> ifgsAfter;
+    uint64_t nextSlot = 0, endSlot = 0;
+    size_t cursor = 0;
+    uint64_t slotFrameId = 0;
+    int slotSubframeId = 0, slotId = 0;
+};
+
+// Thread pool with one task deque per worker; a worker runs its own tasks and steals from the others when idle
+class WorkStealingPool
+{
+public:
+    typedef std::function<void(unsigned worker)> Task;
+
+    explicit WorkStealingPool(unsigned threads) : pending(0), stopping(false), next(0)
+    {
+        for (unsigned i = 0; i < threads; ++i)
+        {
+            queues.emplace_back(new Queue());
+        }
+        for (unsigned i = 0; i < threads; ++i)
+        {
+            workers.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+        }
+    }
+
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    unsigned Size() const { return static_cast<unsigned>(workers.size()); }
+
+    // Queue a task on the workers in turn
+    void Submit(Task task)
+    {
+        Queue& queue = *queues[next++ % queues.size()];
+        {
+            std::lock_guard<std::mutex> guard(queue.lock);
+            queue.tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            ++pending;
+        }
+        wake.notify_one();
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    // Own queue first (oldest task first, keeping the output order close to the submit order), then steal
+    bool TryRun(unsigned worker)
+    {
+        for (size_t i = 0; i < queues.size(); ++i)
+        {
+            Queue& queue = *queues[(worker + i) % queues.size()];
+            Task task;
+            {
+                std::lock_guard<std::mutex> guard(queue.lock);
+                if (queue.tasks.empty())
+                    continue;
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            {
+                std::lock_guard<std::mutex> guard(sleepLock);
+                --pending;
+            }
+            task(worker);
+            return true;
+        }
+        return false;
+    }
+
+    void WorkerLoop(unsigned worker)
+    {
+        while (true)
+        {
+            if (TryRun(worker))
+                continue;
+            std::unique_lock<std::mutex> guard(sleepLock);
+            wake.wait(guard, [this]() { return stopping || pending > 0; });
+            if (stopping && pending == 0)
+                return;
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    size_t pending;
+    bool stopping;
+    std::atomic<unsigned> next;
+};
+
+// Cycle counter for timing hot paths: the TSC on x86, the steady clock in ns elsewhere
+struct CycleCounter
+{
+    static uint64_t Now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+};
+
+// Histogram of durations in cycles, one bucket per power of two
+class LatencyHistogram
+{
+public:
+    static const int Buckets = 48;
+
+    void Add(uint64_t cycles)
+    {
+        int bucket = cycles == 0 ? 0 : std::min(Buckets - 1, 64 - __builtin_clzll(cycles));
+        ++counts[bucket];
+        ++samples;
+        total += cycles;
+        maximum = std::max(maximum, cycles);
+    }
+
+    void Merge(const LatencyHistogram& other)
+    {
+        for (int i = 0; i < Buckets; ++i)
+        {
+            counts[i] += other.counts[i];
+        }
+        samples += other.samples;
+        total += other.total;
+        maximum = std::max(maximum, other.maximum);
+    }
+
+    uint64_t Samples() const { return samples; }
+    uint64_t Total() const { return total; }
+    uint64_t Maximum() const { return maximum; }
+
+    // Upper bound of the bucket holding the given fraction of the samples
+    uint64_t Percentile(double fraction) const
+    {
+        uint64_t wanted = static_cast<uint64_t>(std::ceil(fraction * samples));
+        uint64_t seen = 0;
+        for (int i = 0; i < Buckets; ++i)
+        {
+            seen += counts[i];
+            if (seen >= wanted && seen != 0)
+                return std::min<uint64_t>(maximum, (1ull << i) - 1);
+        }
+        return maximum;
+    }
+
+private:
+    uint64_t counts[Buckets] = {};
+    uint64_t samples = 0;
+    uint64_t total = 0;
+    uint64_t maximum = 0;
+};
+
+// Counters and timings of one generation run
+// Every thread records into its own slot (no sharing on the hot path); the writer thread also keeps the packet
+// tallies and prints rate-limited progress. At the end the slots are merged into a JSON summary and, optionally,
+// a Chrome trace (chrome://tracing, Perfetto) with one event per timed slot
+class RunStatistics
+{
+public:
+    enum Stage { Encode, Wait, Write, StageCount };
+
+    struct Tally
+    {
+        uint64_t streams = 1;             // eAxC streams interleaved on the link
+        uint64_t ethernetFrames = 0;
+        uint64_t oranPackets = 0;
+        uint64_t fragmentedPackets = 0;   // ORAN packets split over more than one frame
+        uint64_t frameBytes = 0;          // preamble/SFD up to the FCS
+        uint64_t gapIFGs = 0;             // IFG bytes following each packet
+        uint64_t fillIFGs = 0;            // IFG bytes filling the idle time of symbols, slots or frames
+        uint64_t timelineNs = 0;          // end of the last packet or fill on the wire, from the start of the shard
+        uint64_t overruns = 0;            // fill units whose packets did not fit in their time
+        double linkUtilization = 0;       // share of the timeline carrying packets
+    };
+
+    // `threads` recording threads, indexed 0 .. threads - 1
+    void Start(unsigned threads, bool keepTrace)
+    {
+        perThread.assign(threads, ThreadCounters());
+        traceEnabled = keepTrace;
+        startCycles = CycleCounter::Now();
+        startTime = std::chrono::steady_clock::now();
+        lastProgress = startTime;
+    }
+
+    // Record one timed call of `stage` on thread `thread`, started at `begin` (CycleCounter::Now())
+    void Record(unsigned thread, Stage stage, uint64_t begin, uint64_t slot)
+    {
+        uint64_t end = CycleCounter::Now();
+        ThreadCounters& counters = perThread[thread];
+        counters.latency[stage].Add(end - begin);
+        if (traceEnabled)
+        {
+            counters.trace.push_back({ begin, end, slot, stage });
+        }
+    }
+
+    Tally& Counts() { return tally; }
+
+    // Print one progress line if at least `intervalMs` passed since the last one (writer thread); `totalFrames` 0
+    // leaves the total out
+    void Progress(uint64_t frameId, uint64_t totalFrames, int intervalMs)
+    {
+        if (intervalMs <= 0)
+            return;
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastProgress < std::chrono::milliseconds(intervalMs))
+            return;
+        lastProgress = now;
+        double seconds = std::chrono::duration<double>(now - startTime).count();
+        std::cout << "Progress: frame " << frameId;
+        if (totalFrames != 0)  // 0: continuous run
+            std::cout << "/" << totalFrames;
+        std::cout << ", " << tally.ethernetFrames
+                  << " Ethernet packets, " << tally.frameBytes * 8 / seconds / 1e9 << " Gbit/s generated" << std::endl;
+    }
+
+    // Stop the clock and merge the per-thread counters
+    void Finish()
+    {
+        elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        uint64_t cycles = CycleCounter::Now() - startCycles;
+        nsPerCycle = cycles ? elapsedSeconds * 1e9 / cycles : 1;
+        for (int stage = 0; stage < StageCount; ++stage)
+        {
+            merged[stage] = LatencyHistogram();
+            for (const ThreadCounters& counters : perThread)
+            {
+                merged[stage].Merge(counters.latency[stage]);
+            }
+        }
+    }
+
+    // One line on the console
+    void PrintSummary() const
+    {
+        std::cout << "Generated " << tally.ethernetFrames << " Ethernet packets (" << tally.oranPackets << " ORAN packets, "
+                  << tally.fragmentedPackets << " fragmented) in " << elapsedSeconds << " s, "
+                  << tally.frameBytes * 8 / std::max(elapsedSeconds, 1e-9) / 1e9 << " Gbit/s";
+        if (tally.streams > 1)
+        {
+            std::cout << " for " << tally.streams << " eAxC streams";
+        }
+        std::cout << std::endl;
+        std::cout << "Timeline: " << tally.timelineNs / 1e6 << " ms on the wire, link utilization "
+                  << tally.linkUtilization * 100 << " %";
+        if (tally.overruns != 0)
+        {
+            std::cout << ", " << tally.overruns << " symbols/slots/frames did not fit in their time";
+        }
+        std::cout << std::endl;
+    }
+
+    bool WriteJson(const std::string& path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+            return false;
+        file << "{\n";
+        file << "  \"elapsed_s\": " << elapsedSeconds << ",\n";
+        file << "  \"timed_threads\": " << perThread.size() << ",\n";  // encoding threads and the writer
+        file << "  \"streams\": " << tally.streams << ",\n";
+        file << "  \"ethernet_packets\": " << tally.ethernetFrames << ",\n";
+        file << "  \"oran_packets\": " << tally.oranPackets << ",\n";
+        file << "  \"fragmented_oran_packets\": " << tally.fragmentedPackets << ",\n";
+        file << "  \"frame_bytes\": " << tally.frameBytes << ",\n";
+        file << "  \"gap_ifg_bytes\": " << tally.gapIFGs << ",\n";
+        file << "  \"fill_ifg_bytes\": " << tally.fillIFGs << ",\n";
+        file << "  \"timeline_ns\": " << tally.timelineNs << ",\n";
+        file << "  \"schedule_overruns\": " << tally.overruns << ",\n";
+        file << "  \"link_utilization\": " << tally.linkUtilization << ",\n";
+        file << "  \"packets_per_s\": " << tally.ethernetFrames / std::max(elapsedSeconds, 1e-9) << ",\n";
+        file << "  \"gbit_per_s\": " << tally.frameBytes * 8 / std::max(elapsedSeconds, 1e-9) / 1e9 << ",\n";
+        file << "  \"stages\": {";
+        for (int stage = 0; stage < StageCount; ++stage)
+        {
+            const LatencyHistogram& histogram = merged[stage];
+            file << (stage ? "," : "") << "\n    \"" << StageName(static_cast<Stage>(stage)) << "\": { "
+                 << "\"calls\": " << histogram.Samples()
+                 << ", \"cycles\": " << histogram.Total()
+                 << ", \"total_ms\": " << histogram.Total() * nsPerCycle / 1e6
+                 << ", \"p50_us\": " << histogram.Percentile(0.5) * nsPerCycle / 1e3
+                 << ", \"p99_us\": " << histogram.Percentile(0.99) * nsPerCycle / 1e3
+                 << ", \"max_us\": " << histogram.Maximum() * nsPerCycle / 1e3 << " }";
+        }
+        file << "\n  }\n}\n";
+        return static_cast<bool>(file);
+    }
+
+    bool WriteTrace(const std::string& path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+            return false;
+        file << "{\"traceEvents\":[";
+        bool first = true;
+        file << std::fixed << std::setprecision(3);
+        for (size_t thread = 0; thread < perThread.size(); ++thread)
+        {
+            for (const TraceEvent& event : perThread[thread].trace)
+            {
+                file << (first ? "\n" : ",\n") << "{\"name\":\"" << StageName(event.stage) << " slot " << event.slot
+                     << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+                     << ",\"ts\":" << (event.begin - startCycles) * nsPerCycle / 1e3
+                     << ",\"dur\":" << (event.end - event.begin) * nsPerCycle / 1e3 << "}";
+                first = false;
+            }
+        }
+        file << "\n]}\n";
+        return static_cast<bool>(file);
+    }
+
+    static const char* StageName(Stage stage)
+    {
+        switch (stage)
+        {
+        case Encode: return "encode";
+        case Wait: return "wait";
+        case Write: return "write";
+        default: return "?";
+        }
+    }
+
+private:
+    struct TraceEvent
+    {
+        uint64_t begin, end;
+        uint64_t slot;
+        Stage stage;
+    };
+
+    struct alignas(64) ThreadCounters
+    {
+        LatencyHistogram latency[StageCount];
+        std::vector<TraceEvent> trace;
+    };
+
+    std::vector<ThreadCounters> perThread;
+    LatencyHistogram merged[StageCount];
+    Tally tally;
+    bool traceEnabled = false;
+    uint64_t startCycles = 0;
+    std::chrono::steady_clock::time_point startTime, lastProgress;
+    double elapsedSeconds = 0;
+    double nsPerCycle = 1;
+};
+
+// Single-producer single-consumer ring of fixed-size byte buffers
+// The producer fills a free buffer and publishes it, the consumer drains published buffers in order and releases
+// them. Only the two counters are shared; each side blocks on the other's counter when the ring is full or empty
+class SPSCBufferRing
+{
+public:
+    struct Buffer
+    {
+        std::unique_ptr<uint8_t[]> data;
+        size_t used;
+        size_t index;  // position in the ring, for state the consumer keeps per buffer
+    };
+
+    void Init(size_t count, size_t bufferSize)
+    {
+        buffers.clear();
+        buffers.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            buffers[i].data.reset(new uint8_t[bufferSize]);
+            buffers[i].used = 0;
+            buffers[i].index = i;
+        }
+        capacity = bufferSize;
+        head.store(0);
+        tail.store(0);
+    }
+
+    size_t Count() const { return buffers.size(); }
+    size_t BufferSize() const { return capacity; }
+
+    // Producer: the next free buffer, waiting while every buffer is still queued for the consumer
+    Buffer& AcquireFree()
+    {
+        size_t published = head.load(std::memory_order_relaxed);
+        size_t released = tail.load(std::memory_order_acquire);
+        while (published - released == buffers.size())
+        {
+            tail.wait(released, std::memory_order_acquire);
+            released = tail.load(std::memory_order_acquire);
+        }
+        Buffer& buffer = buffers[published % buffers.size()];
+        buffer.used = 0;
+        return buffer;
+    }
+
+    // Producer: hand the acquired buffer to the consumer
+    void Publish()
+    {
+        head.fetch_add(1, std::memory_order_release);
+        head.notify_one();
+    }
+
+    // Consumer: number of published buffers, waiting until there is at least one
+    size_t WaitFilled()
+    {
+        size_t released = tail.load(std::memory_order_relaxed);
+        size_t published = head.load(std::memory_order_acquire);
+        while (published == released)
+        {
+            head.wait(published, std::memory_order_acquire);
+            published = head.load(std::memory_order_acquire);
+        }
+        return published - released;
+    }
+
+    // Consumer: the i-th published buffer not yet released
+    Buffer& Filled(size_t i) { return buffers[(tail.load(std::memory_order_relaxed) + i) % buffers.size()]; }
+
+    // Consumer: give the oldest `count` buffers back to the producer
+    void Release(size_t count)
+    {
+        tail.fetch_add(count, std::memory_order_release);
+        tail.notify_one();
+    }
+
+private:
+    std::vector<Buffer> buffers;
+    size_t capacity = 0;
+    alignas(64) std::atomic<size_t> head{0};   // buffers published by the producer
+    alignas(64) std::atomic<size_t> tail{0};   // buffers released by the consumer
+};
+
+// Compressed capture files (Output.Compression). The output is cut into blocks, one 4 MB writer buffer each, and
+// every block is compressed on its own into a complete LZ4 or zstd frame, so blocks compress in parallel and decode
+// independently. The frames are followed by a seek table in the zstd seekable format: a skippable frame listing the
+// compressed and decompressed size of every frame, which the lz4 and zstd tools skip. A reader finds block k from
+// the table and can start decoding there. LZ4 is built in; zstd needs libzstd (-DMILESTONE2_WITH_ZSTD -lzstd)
+class CaptureCompression
+{
+public:
+    enum Method { None, Lz4, Zstd };
+
+    static const uint32_t Lz4FrameMagic = 0x184D2204;
+    static const uint32_t ZstdFrameMagic = 0xFD2FB528;
+    static const uint32_t SeekTableMagic = 0x184D2A5E;   // skippable frame holding the seek table
+    static const uint32_t SeekableMagic = 0x8F92EAB1;    // last 4 bytes of a file with a seek table
+    static const size_t MaxBlockSize = 4 << 20;          // largest LZ4 frame block
+
+    Method method = None;
+    int level = 0;          // zstd level or LZ4 acceleration, 0 = the default of the method
+    unsigned threads = 1;   // compression threads
+
+    // none, lz4 or zstd; false for an unknown method, or zstd in a build without libzstd
+    static bool Parse(const std::string& name, int level, int threads, CaptureCompression& compression)
+    {
+        if (name == "none" || name.empty())
+            compression.method = None;
+        else if (name == "lz4")
+            compression.method = Lz4;
+#ifdef MILESTONE2_ZSTD
+        else if (name == "zstd")
+            compression.method = Zstd;
+#endif
+        else
+            return false;
+        compression.level = level;
+        compression.threads = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+        return true;
+    }
+
+    bool Enabled() const { return method != None; }
+    const char* Name() const { return method == Lz4 ? "lz4" : method == Zstd ? "zstd" : "none"; }
+    const char* Extension() const { return method == Lz4 ? ".lz4" : method == Zstd ? ".zst" : ""; }
+
+    // Per-thread working memory
+    struct Scratch
+    {
+        std::vector<uint32_t> hashTable;
+#ifdef MILESTONE2_ZSTD
+        std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx*)> context{ nullptr, ZSTD_freeCCtx };
+#endif
+    };
+
+    // Compress `size` bytes (at most MaxBlockSize) into one complete frame, replacing the contents of `frame`
+    void CompressFrame(const uint8_t* data, size_t size, std::vector<uint8_t>& frame, Scratch& scratch) const
+    {
+#ifdef MILESTONE2_ZSTD
+        if (method == Zstd)
+        {
+            if (!scratch.context)
+                scratch.context.reset(ZSTD_createCCtx());
+            frame.resize(ZSTD_compressBound(size));
+            size_t length = ZSTD_compressCCtx(scratch.context.get(), frame.data(), frame.size(), data, size, level ? level : 3);
+            frame.resize(ZSTD_isError(length) ? 0 : length);
+            return;
+        }
+#endif
+        // frame header: independent blocks of up to 4 MB, content size given
+        frame.resize(15 + 4 + Lz4CompressBound(size) + 4);
+        uint8_t* out = frame.data();
+        PutLe32(out, Lz4FrameMagic);
+        out[4] = 0x68;  // version 01, block independence, content size
+        out[5] = 0x70;  // block maximum size 4 MB
+        PutLe32(out + 6, static_cast<uint32_t>(size));
+        PutLe32(out + 10, static_cast<uint32_t>(static_cast<uint64_t>(size) >> 32));
+        out[14] = static_cast<uint8_t>(Xxh32(out + 4, 10, 0) >> 8);
+
+        // one block, stored as it is if it does not get smaller
+        scratch.hashTable.resize(Lz4HashSize);
+        size_t length = Lz4CompressBlock(data, size, out + 19, scratch.hashTable.data(), std::max(level, 1));
+        if (length >= size)
+        {
+            std::memcpy(out + 19, data, size);
+            length = size;
+            PutLe32(out + 15, static_cast<uint32_t>(size) | 0x80000000u);
+        }
+        else
+        {
+            PutLe32(out + 15, static_cast<uint32_t>(length));
+        }
+        PutLe32(out + 19 + length, 0);  // end mark
+        frame.resize(19 + length + 4);
+    }
+
+    // Seek table for frames of the given compressed and decompressed sizes
+    static std::vector<uint8_t> SeekTable(const std::vector<std::pair<uint32_t, uint32_t>>& frames)
+    {
+        std::vector<uint8_t> table(8 + frames.size() * 8 + 9);
+        PutLe32(&table[0], SeekTableMagic);
+        PutLe32(&table[4], static_cast<uint32_t>(table.size() - 8));
+        for (size_t i = 0; i < frames.size(); ++i)
+        {
+            PutLe32(&table[8 + i * 8], frames[i].first);
+            PutLe32(&table[12 + i * 8], frames[i].second);
+        }
+        uint8_t* footer = &table[table.size() - 9];
+        PutLe32(footer, static_cast<uint32_t>(frames.size()));
+        footer[4] = 0;  // no checksums
+        PutLe32(footer + 5, SeekableMagic);
+        return table;
+    }
+
+    // Whether a file starting with `magic` (its first 4 bytes, little-endian) is compressed
+    static bool IsCompressed(uint32_t magic) { return magic == Lz4FrameMagic || magic == ZstdFrameMagic; }
+
+    // Place of one frame of a compressed file, from its seek table
+    struct SeekEntry
+    {
+        size_t offset, compressed;        // in the file
+        size_t outOffset, decompressed;   // in the decompressed capture
+    };
+
+    // The frames of a file with a seek table, in order; false if the file has none
+    static bool ReadSeekTable(const uint8_t* data, size_t size, std::vector<SeekEntry>& entries)
+    {
+        if (size < 17 || Le32(data + size - 4) != SeekableMagic)
+            return false;
+        const uint8_t* footer = data + size - 9;
+        const size_t count = Le32(footer);
+        const size_t entrySize = footer[4] & 0x80 ? 12 : 8;
+        const size_t tableLength = count * entrySize + 9;
+        if (tableLength + 8 > size)
+            return false;
+        const uint8_t* table = data + size - tableLength - 8;
+        if (Le32(table) != SeekTableMagic || Le32(table + 4) != tableLength)
+            return false;
+        const size_t framesEnd = table - data;
+        size_t offset = 0, outOffset = 0;
+        entries.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            entries[i] = { offset, Le32(table + 8 + i * entrySize), outOffset, Le32(table + 12 + i * entrySize) };
+            offset += entries[i].compressed;
+            outOffset += entries[i].decompressed;
+            if (offset > framesEnd)
+                return false;
+        }
+        return true;
+    }
+
+    // Decode frames [first, last) of the seek table on `threads` threads, each straight to its place in `out`, which
+    // receives the decompressed bytes from entries[first].outOffset on. False with `error` set for a malformed frame
+    static bool DecodeFrames(const uint8_t* data, const std::vector<SeekEntry>& entries, size_t first, size_t last,
+                             unsigned threads, uint8_t* out, std::string& error)
+    {
+        std::atomic<size_t> next{first};
+        std::atomic<bool> failed{false};
+        std::mutex errorLock;
+        auto work = [&]()
+        {
+            std::vector<uint8_t> frame;
+            std::string frameError;
+            for (size_t i = next++; i < last && !failed; i = next++)
+            {
+                const SeekEntry& entry = entries[i];
+                size_t consumed;
+                frame.clear();
+                bool ok = DecodeFrame(data + entry.offset, entry.compressed, consumed, frame, frameError);
+                if (ok && frame.size() != entry.decompressed)
+                {
+                    ok = false;
+                    frameError = "frame size differs from the seek table";
+                }
+                if (!ok)
+                {
+                    std::lock_guard<std::mutex> guard(errorLock);
+                    error = "block " + std::to_string(i) + ": " + frameError;
+                    failed = true;
+                    return;
+                }
+                std::memcpy(out + (entry.outOffset - entries[first].outOffset), frame.data(), frame.size());
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < std::min<size_t>(std::max(1u, threads), last - first); ++t)
+            workers.emplace_back(work);
+        work();
+        for (std::thread& worker : workers)
+            worker.join();
+        return !failed;
+    }
+
+    // Decompress a whole compressed file into `out`. With a seek table the frames are decoded on `threads` threads
+    // (DecodeFrames); without one (e.g. a file from the lz4 tool) one after the other. False with `error` set for a
+    // malformed or unsupported stream
+    static bool Decompress(const uint8_t* data, size_t size, unsigned threads, std::vector<uint8_t>& out, std::string& error)
+    {
+        out.clear();
+        std::vector<SeekEntry> entries;
+        if (ReadSeekTable(data, size, entries))
+        {
+            out.resize(entries.empty() ? 0 : entries.back().outOffset + entries.back().decompressed);
+            return DecodeFrames(data, entries, 0, entries.size(), threads, out.data(), error);
+        }
+
+        for (size_t pos = 0; pos < size;)
+        {
+            size_t consumed;
+            if (!DecodeFrame(data + pos, size - pos, consumed, out, error))
+            {
+                error += " at byte " + std::to_string(pos);
+                return false;
+            }
+            pos += consumed;
+        }
+        return true;
+    }
+
+    // LZ4 block format: sequences of literals and a match of 4+ bytes at most 64 KB back, the matches found through a
+    // hash of the next 4 bytes. Misses make the search step grow, faster with a larger `acceleration`. `out` must
+    // hold Lz4CompressBound(size) bytes and `table` Lz4HashSize entries. Returns the compressed length
+    static const size_t Lz4HashSize = 1 << 16;
+
+    static size_t Lz4CompressBound(size_t size) { return size + size / 255 + 16; }
+
+    static size_t Lz4CompressBlock(const uint8_t* src, size_t size, uint8_t* out, uint32_t* table, int acceleration)
+    {
+        const size_t MinMatch = 4, LastLiterals = 5, MatchFindLimit = 12;
+        const uint8_t* const end = src + size;
+        const uint8_t* anchor = src;
+        uint8_t* op = out;
+        if (size > MatchFindLimit)
+        {
+            const uint8_t* const matchLimit = end - LastLiterals;
+            const uint8_t* const findLimit = end - MatchFindLimit;
+            std::fill(table, table + Lz4HashSize, 0);
+            const uint8_t* ip = src + 1;
+            size_t misses = 0;
+            while (ip < findLimit)
+            {
+                uint32_t sequence = LoadNative32(ip);
+                uint32_t& entry = table[Lz4Hash(sequence)];
+                const uint8_t* match = src + entry;
+                entry = static_cast<uint32_t>(ip - src);
+                if (match >= ip || ip - match > 65535 || LoadNative32(match) != sequence)
+                {
+                    ip += (static_cast<size_t>(acceleration) * 64 + misses++) >> 6;
+                    continue;
+                }
+                while (ip > anchor && match > src && ip[-1] == match[-1])
+                {
+                    --ip;
+                    --match;
+                }
+                const uint8_t* a = ip + MinMatch;
+                const uint8_t* b = match + MinMatch;
+                bool differs = false;
+                while (!differs && a + 8 <= matchLimit)
+                {
+                    uint64_t x, y;
+                    std::memcpy(&x, a, 8);
+                    std::memcpy(&y, b, 8);
+                    if (x != y)
+                    {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+                        a += __builtin_ctzll(x ^ y) >> 3;
+#else
+                        a += __builtin_clzll(x ^ y) >> 3;
+#endif
+                        differs = true;
+                    }
+                    else
+                    {
+                        a += 8;
+                        b += 8;
+                    }
+                }
+                while (!differs && a < matchLimit && *a == *b)
+                {
+                    ++a;
+                    ++b;
+                }
+                op = Lz4Sequence(op, anchor, ip - anchor, ip - match, a - ip);
+                ip = a;
+                anchor = ip;
+                misses = 0;
+                if (ip < findLimit)
+                    table[Lz4Hash(LoadNative32(ip - 2))] = static_cast<uint32_t>(ip - 2 - src);
+            }
+        }
+        return Lz4Sequence(op, anchor, end - anchor, 0, 0) - out;
+    }
+
+    // Append the decoded LZ4 block to `out`, producing at most `limit` bytes; matches may reach back into what `out`
+    // held before (linked blocks). False for a corrupt block
+    static bool Lz4DecompressBlock(const uint8_t* p, size_t size, std::vector<uint8_t>& out, size_t limit)
+    {
+        const uint8_t* const end = p + size;
+        size_t pos = out.size();
+        const size_t outEnd = pos + limit;
+        out.resize(outEnd);
+        uint8_t* base = out.data();
+        while (p < end)
+        {
+            uint8_t token = *p++;
+            size_t literals = token >> 4;
+            if (literals == 15 && !Lz4Length(p, end, literals))
+                return false;
+            if (literals > static_cast<size_t>(end - p) || literals > outEnd - pos)
+                return false;
+            std::memcpy(base + pos, p, literals);
+            pos += literals;
+            p += literals;
+            if (p == end)
+                break;  // the last sequence has no match
+            if (end - p < 2)
+                return false;
+            size_t offset = p[0] | p[1] << 8;
+            p += 2;
+            size_t length = token & 15;
+            if (length == 15 && !Lz4Length(p, end, length))
+                return false;
+            length += 4;
+            if (offset == 0 || offset > pos || length > outEnd - pos)
+                return false;
+            uint8_t* dst = base + pos;
+            if (offset >= length)
+            {
+                std::memcpy(dst, dst - offset, length);
+            }
+            else
+            {
+                // a repeating pattern: copy whole periods, doubling the copied span each time
+                for (size_t done = 0; done < length;)
+                {
+                    size_t part = std::min(done + offset, length - done);
+                    std::memcpy(dst + done, dst - offset, part);
+                    done += part;
+                }
+            }
+            pos += length;
+        }
+        out.resize(pos);
+        return true;
+    }
+
+    // xxHash32, for the LZ4 frame header checksum
+    static uint32_t Xxh32(const uint8_t* p, size_t size, uint32_t seed)
+    {
+        const uint32_t Prime1 = 2654435761u, Prime2 = 2246822519u, Prime3 = 3266489917u, Prime4 = 668265263u, Prime5 = 374761393u;
+        auto rotl = [](uint32_t x, int r) { return (x << r) | (x >> (32 - r)); };
+        const uint8_t* const end = p + size;
+        uint32_t h;
+        if (size >= 16)
+        {
+            uint32_t v[4] = { seed + Prime1 + Prime2, seed + Prime2, seed, seed - Prime1 };
+            for (; end - p >= 16; p += 16)
+            {
+                for (int lane = 0; lane < 4; ++lane)
+                    v[lane] = rotl(v[lane] + Le32(p + lane * 4) * Prime2, 13) * Prime1;
+            }
+            h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+        }
+        else
+        {
+            h = seed + Prime5;
+        }
+        h += static_cast<uint32_t>(size);
+        for (; end - p >= 4; p += 4)
+            h = rotl(h + Le32(p) * Prime3, 17) * Prime4;
+        for (; p < end; ++p)
+            h = rotl(h + *p * Prime5, 11) * Prime1;
+        h ^= h >> 15;
+        h *= Prime2;
+        h ^= h >> 13;
+        h *= Prime3;
+        h ^= h >> 16;
+        return h;
+    }
+
+    static uint32_t Le32(const uint8_t* p) { return p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24; }
+
+    static void PutLe32(uint8_t* p, uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+            p[i] = static_cast<uint8_t>(value >> (i * 8));
+    }
+
+private:
+    static uint32_t LoadNative32(const uint8_t* p)
+    {
+        uint32_t value;
+        std::memcpy(&value, p, 4);
+        return value;
+    }
+
+    static uint32_t Lz4Hash(uint32_t sequence) { return (sequence * 2654435761u) >> 16; }
+
+    // One sequence: `literalCount` literals, then a match of `matchLength` bytes `offset` back (none if 0)
+    static uint8_t* Lz4Sequence(uint8_t* op, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength)
+    {
+        auto putLength = [&op](size_t length)
+        {
+            for (length -= 15; length >= 255; length -= 255)
+                *op++ = 255;
+            *op++ = static_cast<uint8_t>(length);
+        };
+        uint8_t* token = op++;
+        *token = static_cast<uint8_t>(std::min<size_t>(literalCount, 15) << 4);
+        if (literalCount >= 15)
+            putLength(literalCount);
+        std::memcpy(op, literals, literalCount);
+        op += literalCount;
+        if (matchLength != 0)
+        {
+            *op++ = static_cast<uint8_t>(offset);
+            *op++ = static_cast<uint8_t>(offset >> 8);
+            size_t extra = matchLength - 4;
+            *token |= static_cast<uint8_t>(std::min<size_t>(extra, 15));
+            if (extra >= 15)
+                putLength(extra);
+        }
+        return op;
+    }
+
+    // Add the 255-continued extension of a length field to `length`
+    static bool Lz4Length(const uint8_t*& p, const uint8_t* end, size_t& length)
+    {
+        uint8_t byte;
+        do
+        {
+            if (p == end)
+                return false;
+            byte = *p++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    // Decode the frame at `data`, appending its bytes to `out`; `consumed` is set to its length. Skippable frames
+    // (a seek table among them) are passed over
+    static bool DecodeFrame(const uint8_t* data, size_t size, size_t& consumed, std::vector<uint8_t>& out, std::string& error)
+    {
+        if (size < 8)
+        {
+            error = "truncated frame";
+            return false;
+        }
+        const uint32_t magic = Le32(data);
+        if ((magic & 0xFFFFFFF0u) == 0x184D2A50u)
+        {
+            uint32_t length = Le32(data + 4);
+            if (length > size - 8)
+            {
+                error = "truncated skippable frame";
+                return false;
+            }
+            consumed = 8 + length;
+            return true;
+        }
+        if (magic == ZstdFrameMagic)
+        {
+#ifdef MILESTONE2_ZSTD
+            size_t length = ZSTD_findFrameCompressedSize(data, size);
+            unsigned long long content = ZSTD_isError(length) ? ZSTD_CONTENTSIZE_ERROR : ZSTD_getFrameContentSize(data, length);
+            if (content == ZSTD_CONTENTSIZE_ERROR || content == ZSTD_CONTENTSIZE_UNKNOWN)
+            {
+                error = "corrupt zstd frame, or one without its content size";
+                return false;
+            }
+            size_t start = out.size();
+            out.resize(start + content);
+            size_t produced = ZSTD_decompress(out.data() + start, content, data, length);
+            if (ZSTD_isError(produced) || produced != content)
+            {
+                error = "corrupt zstd frame";
+                return false;
+            }
+            consumed = length;
+            return true;
+#else
+            error = "zstd frame in a build without libzstd (build with -DMILESTONE2_WITH_ZSTD -lzstd)";
+            return false;
+#endif
+        }
+        if (magic != Lz4FrameMagic)
+        {
+            error = "not an LZ4 or zstd frame";
+            return false;
+        }
+
+        const uint8_t flags = data[4], blockDescriptor = data[5];
+        const bool blockChecksums = flags & 0x10, contentSize = flags & 0x08, contentChecksum = flags & 0x04;
+        const size_t headerLength = 7 + (contentSize ? 8 : 0) + (flags & 0x01 ? 4 : 0);
+        if ((flags >> 6) != 1 || size < headerLength ||
+            static_cast<uint8_t>(Xxh32(data + 4, headerLength - 5, 0) >> 8) != data[headerLength - 1])
+        {
+            error = "bad LZ4 frame header";
+            return false;
+        }
+        if (flags & 0x01)
+        {
+            error = "LZ4 frame with a dictionary";
+            return false;
+        }
+        const size_t blockMax = size_t(1) << (8 + 2 * ((blockDescriptor >> 4) & 7));
+        if (contentSize)
+            out.reserve(out.size() + Le32(data + 6));
+        size_t pos = headerLength;
+        while (true)
+        {
+            if (size - pos < 4)
+            {
+                error = "truncated LZ4 frame";
+                return false;
+            }
+            uint32_t word = Le32(data + pos);
+            pos += 4;
+            if (word == 0)
+                break;
+            size_t length = word & 0x7FFFFFFF;
+            if (length > blockMax || length + (blockChecksums ? 4 : 0) > size - pos)
+            {
+                error = "bad LZ4 block length";
+                return false;
+            }
+            if (word & 0x80000000u)
+            {
+                out.insert(out.end(), data + pos, data + pos + length);
+            }
+            else if (!Lz4DecompressBlock(data + pos, length, out, blockMax))
+            {
+                error = "corrupt LZ4 block";
+                return false;
+            }
+            pos += length + (blockChecksums ? 4 : 0);
+        }
+        if (contentChecksum)
+        {
+            if (size - pos < 4)
+            {
+                error = "truncated LZ4 frame";
+                return false;
+            }
+            pos += 4;
+        }
+        consumed = pos;
+        return true;
+    }
+};
+
+// Writes bytes to a file through large buffers so the disk sees multi-MB writes
+// With a ring (Open with ringBytes > 0) the buffers are written by a dedicated thread with writev while the caller
+// keeps generating; memory stays bounded by the ring size whatever the length of the capture. With compression every
+// buffer becomes one compressed block: the writer thread hands the published buffers to a pool of compression
+// threads and writes the blocks in order as they complete, then the seek table at Close
+class BufferedFileWriter
+{
+public:
+    explicit BufferedFileWriter(size_t bufferSize = 4 << 20) : fd(-1), bufferSize(bufferSize), current(nullptr),
+                                                               used(0), writeFailed(false) {}
+
+    ~BufferedFileWriter() { Close(); }
+
+    bool Open(const std::string& path, size_t ringBytes = 0, const CaptureCompression& compression = CaptureCompression())
+    {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            return false;
+        }
+        writeFailed = false;
+        used = 0;
+        flushed = 0;
+        preallocated = 0;
+        this->compression = compression;
+        if (compression.Enabled())
+        {
+            // enough buffers in flight to keep every compression thread busy
+            ringBytes = std::max<size_t>(ringBytes, (2 * compression.threads + 2) * bufferSize);
+            compressionPool.reset(new WorkStealingPool(compression.threads));
+            scratch.resize(compression.threads);
+        }
+        if (ringBytes > 0)
+        {
+            ring.Init(std::max<size_t>(2, ringBytes / bufferSize), bufferSize);
+            currentBuffer = &ring.AcquireFree();
+            current = currentBuffer->data.get();
+            if (compression.Enabled())
+            {
+                packed.reset(new PackedBlock[ring.Count()]);
+                writerThread = std::thread(&BufferedFileWriter::CompressingWriterLoop, this);
+            }
+            else
+            {
+                writerThread = std::thread(&BufferedFileWriter::WriterLoop, this);
+            }
+        }
+        else
+        {
+            localBuffer.reset(new uint8_t[bufferSize]);
+            current = localBuffer.get();
+        }
+        return true;
+    }
+
+    void Write(const void* data, size_t length)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        while (used + length > bufferSize)
+        {
+            size_t part = bufferSize - used;
+            std::memcpy(current + used, bytes, part);
+            used += part;
+            bytes += part;
+            length -= part;
+            Flush();
+        }
+        std::memcpy(current + used, bytes, length);
+        used += length;
+    }
+
+    template <typename T>
+    void WriteValue(T value) { Write(&value, sizeof(value)); } // host byte order, as pcap readers expect
+
+    // Contiguous room for up to `length` bytes (at most the buffer size) to format output in place,
+    // then Commit() the bytes actually produced
+    uint8_t* Reserve(size_t length)
+    {
+        if (used + length > bufferSize)
+            Flush();
+        return current + used;
+    }
+
+    void Commit(size_t length) { used += length; }
+
+    // Bytes written since Open, buffered ones included (before compression)
+    uint64_t BytesWritten() const { return flushed + used; }
+
+    // Reserve `bytes` of disk space for the file without changing its size, so a long capture is laid out in large
+    // extents and a full disk shows at Open rather than mid-run. Close trims what was not used. Best effort: false
+    // where the file system (or the platform) cannot preallocate
+    bool Preallocate(uint64_t bytes)
+    {
+#if defined(__linux__)
+        if (fd < 0 || compression.Enabled() || ::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(bytes)) != 0)
+            return false;
+        preallocated = bytes;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Hand the buffered bytes to the writer thread, or write them now without a ring
+    void Flush()
+    {
+        if (fd < 0 || used == 0)
+            return;
+        if (writerThread.joinable())
+        {
+            PublishCurrent();
+            currentBuffer = &ring.AcquireFree();
+            current = currentBuffer->data.get();
+        }
+        else
+        {
+            struct iovec chunk = { current, used };
+            WriteAll(&chunk, 1);
+            flushed += used;
+            used = 0;
+        }
+    }
+
+    void Close()
+    {
+        if (fd < 0)
+            return;
+        if (writerThread.joinable())
+        {
+            Flush();
+            // an empty buffer tells the writer thread to stop
+            PublishCurrent();
+            writerThread.join();
+            compressionPool.reset();
+        }
+        else
+        {
+            Flush();
+        }
+        // give back the preallocated blocks past the end of the data
+        if (preallocated > flushed && !writeFailed && ::ftruncate(fd, static_cast<off_t>(flushed)) != 0)
+            writeFailed = true;
+        ::close(fd);
+        fd = -1;
+        if (writeFailed)
+        {
+            std::cerr << "Error writing output file." << std::endl;
+        }
+    }
+
+    // True once a write, the preallocation trim or the compression failed; valid after Close()
+    bool Failed() const { return writeFailed; }
+
+private:
+    // Hand the buffer being filled to the writer thread
+    void PublishCurrent()
+    {
+        currentBuffer->used = used;
+        ring.Publish();
+        flushed += used;
+        used = 0;
+    }
+
+    void WriteAll(struct iovec* chunks, int count)
+    {
+        while (count > 0 && !writeFailed)
+        {
+            ssize_t written = ::writev(fd, chunks, count);
+            if (written < 0)
+            {
+                writeFailed = true;
+                return;
+            }
+            // skip what was written, possibly stopping inside a chunk
+            while (count > 0 && static_cast<size_t>(written) >= chunks->iov_len)
+            {
+                written -= chunks->iov_len;
+                ++chunks;
+                --count;
+            }
+            if (count > 0)
+            {
+                chunks->iov_base = static_cast<uint8_t*>(chunks->iov_base) + written;
+                chunks->iov_len -= written;
+            }
+        }
+    }
+
+    // Writer thread: write every published buffer with as few writev calls as possible
+    void WriterLoop()
+    {
+        std::vector<struct iovec> chunks;
+        while (true)
+        {
+            size_t filled = std::min<size_t>(ring.WaitFilled(), IOV_MAX);
+            size_t count = 0;
+            bool last = false;
+            chunks.clear();
+            for (; count < filled; ++count)
+            {
+                SPSCBufferRing::Buffer& buffer = ring.Filled(count);
+                if (buffer.used == 0)
+                {
+                    last = true;
+                    break;
+                }
+                chunks.push_back({ buffer.data.get(), buffer.used });
+            }
+            WriteAll(chunks.data(), static_cast<int>(chunks.size()));
+            ring.Release(count);
+            if (last)
+                return;
+        }
+    }
+
+    // Compression: the compressed block of a ring buffer, `ready` once a compression thread produced it
+    struct PackedBlock
+    {
+        std::vector<uint8_t> frame;
+        std::atomic<bool> ready{false};
+    };
+
+    // Writer thread with compression: queue every newly published buffer on the compression pool, then write the
+    // oldest blocks once compressed, releasing their buffers; the seek table follows the last block
+    void CompressingWriterLoop()
+    {
+        std::vector<std::pair<uint32_t, uint32_t>> seekTable;  // compressed and decompressed size of every block
+        std::vector<struct iovec> chunks;
+        size_t queued = 0;  // published buffers, oldest first, handed to the pool
+        while (true)
+        {
+            size_t filled = std::min<size_t>(ring.WaitFilled(), IOV_MAX);
+            for (; queued < filled && ring.Filled(queued).used != 0; ++queued)
+            {
+                SPSCBufferRing::Buffer* buffer = &ring.Filled(queued);
+                compressionPool->Submit([this, buffer](unsigned worker)
+                {
+                    PackedBlock& block = packed[buffer->index];
+                    compression.CompressFrame(buffer->data.get(), buffer->used, block.frame, scratch[worker]);
+                    block.ready.store(true, std::memory_order_release);
+                    block.ready.notify_one();
+                });
+            }
+
+            // the oldest block (waiting for it) and the ones after it that are done already
+            size_t count = 0;
+            bool last = false;
+            chunks.clear();
+            for (; count < filled; ++count)
+            {
+                SPSCBufferRing::Buffer& buffer = ring.Filled(count);
+                if (buffer.used == 0)
+                {
+                    last = true;
+                    break;
+                }
+                PackedBlock& block = packed[buffer.index];
+                if (count > 0 && !block.ready.load(std::memory_order_acquire))
+                    break;
+                block.ready.wait(false, std::memory_order_acquire);
+                chunks.push_back({ block.frame.data(), block.frame.size() });
+                seekTable.push_back({ static_cast<uint32_t>(block.frame.size()), static_cast<uint32_t>(buffer.used) });
+            }
+            WriteAll(chunks.data(), static_cast<int>(chunks.size()));
+            for (size_t i = 0; i < count; ++i)
+                packed[ring.Filled(i).index].ready.store(false, std::memory_order_relaxed);
+            ring.Release(count);
+            queued -= count;
+            if (last)
+            {
+                std::vector<uint8_t> table = CaptureCompression::SeekTable(seekTable);
+                struct iovec chunk = { table.data(), table.size() };
+                WriteAll(&chunk, 1);
+                return;
+            }
+        }
+    }
+
+    int fd;
+    size_t bufferSize;
+    uint8_t* current;                   // buffer being filled
+    size_t used;
+    uint64_t flushed = 0;               // bytes handed to write(2) or to the writer thread
+    uint64_t preallocated = 0;
+    SPSCBufferRing::Buffer* currentBuffer = nullptr;
+    std::unique_ptr<uint8_t[]> localBuffer;
+    SPSCBufferRing ring;
+    CaptureCompression compression;
+    std::unique_ptr<PackedBlock[]> packed;              // per ring buffer
+    std::vector<CaptureCompression::Scratch> scratch;   // per compression thread
+    std::unique_ptr<WorkStealingPool> compressionPool;
+    std::thread writerThread;
+    std::atomic<bool> writeFailed;
+};
+
+// The file sinks write through a ring of Output.RingSizeMB, compressed as Output.Compression says (main has
+// checked the setting; an unusable one writes uncompressed)
+bool OpenOutputWriter(BufferedFileWriter& writer, const std::string& path)
+{
+    CaptureCompression compression;
+    if (!CaptureCompression::Parse(output_compression, output_compression_level, output_compression_threads, compression))
+        compression = CaptureCompression();
+    return writer.Open(path, static_cast<size_t>(output_ring_mb) << 20, compression);
+}
+
+// Destination of the generated Ethernet packets
+// Packets are handed over as built by GenerateEthernetPackets: preamble/SFD up to the FCS, without IFGs
+class PacketSink
+{
+public:
+    virtual ~PacketSink() {}
+    virtual bool Open(const std::string& path) = 0;
+    virtual void BeginFrame(uint64_t /*frameId*/) {}              // start of a 10 ms radio frame
+    virtual void WritePacket(const uint8_t* packet, size_t length, uint64_t timestampNs) = 0;
+    virtual void EndGroup() {}                                     // all fragments of one ORAN packet were written
+    virtual void FillIFGs(uint64_t /*ifgCount*/) {}               // idle time at the end of a symbol or slot
+    virtual void EndFrame(uint64_t /*ifgCount*/) {}                // IFGs filling the rest of the radio frame
+    virtual void Close() = 0;
+
+    // Output rotation (file sinks): continue the capture in a new file, a complete capture of its own
+    virtual bool Rotate(const std::string& path) { Close(); return Open(path); }
+    virtual uint64_t BytesWritten() const { return 0; }            // in the current file
+    virtual bool Preallocate(uint64_t /*bytes*/) { return false; } // reserve disk space for the current file
+};
+
+// Entry b holds the two digits of b, a space and a line break; entries are stored 4 bytes at a time 3 bytes apart,
+// so the line break of the fourth byte of a line is already in place
+constexpr std::array<uint32_t, 256> MakeHexDigitTable()
+{
+    std::array<uint32_t, 256> table{};
+    const char digits[] = "0123456789abcdef";
+    for (uint32_t b = 0; b < 256; ++b)
+    {
+        uint32_t chars[4] = { static_cast<uint8_t>(digits[b >> 4]), static_cast<uint8_t>(digits[b & 0xF]), ' ', '\n' };
+        table[b] = chars[0] | chars[1] << 8 | chars[2] << 16 | chars[3] << 24;  // memory order on little-endian
+    }
+    return table;
+}
+
+constexpr std::array<uint32_t, 256> HexDigitTable = MakeHexDigitTable();
+
+// Legacy text format: two hex digits and a space per byte, a line break after every fourth byte, IFGs as 07
+// Bytes are formatted through a table of digit pairs, a whole 4-byte line at a time, straight into the writer's
+// 4 MB buffers; runs of IFGs are copied from a block of pre-formatted lines. The output is the same as formatting
+// every byte with std::hex / std::setw(2) / std::setfill('0') on an ostream
+class TextPacketSink : public PacketSink
+{
+public:
+    TextPacketSink() : column(0) {}
+
+    bool Open(const std::string& path) override
+    {
+        column = 0;
+        return OpenOutputWriter(writer, path);
+    }
+
+    void BeginFrame(uint64_t frameId) override
+    {
+        // the stream was left in hex by the bytes before, frame 0 reads the same in both
+        char line[32];
+        int length = std::snprintf(line, sizeof(line), "Frame : %" PRIx64 "\n", frameId);
+        writer.Write(line, length);
+    }
+
+    void WritePacket(const uint8_t* packet, size_t length, uint64_t /*timestampNs*/) override
+    {
+        WriteBytes(packet, length, column);
+        // Add the IFGs following the packet, realigning to 4 bytes
+        WriteIFGs(EthernetPacket::GapIFGs(length, MinNumOfIFGsPerPacket), column);
+    }
+
+    void FillIFGs(uint64_t ifgCount) override
+    {
+        WriteIFGs(ifgCount, column);
+    }
+
+    void EndGroup() override
+    {
+        writer.Write("\n", 1);
+    }
+
+    void EndFrame(uint64_t ifgCount) override
+    {
+        // Add IFGs to be sent in the remaining time of the frame, in lines of their own
+        static const char heading[] = "\nSending IFGs in the remaining time....\n";
+        writer.Write(heading, sizeof(heading) - 1);
+        unsigned frameColumn = 0;
+        WriteIFGs(ifgCount, frameColumn);
+        writer.Write("\n", 1);
+    }
+
+    void Close() override
+    {
+        writer.Close();
+    }
+
+    // The lines carry on in the new file as if it followed the old one, so the segments concatenate to the capture
+    // of a run without rotation
+    bool Rotate(const std::string& path) override
+    {
+        writer.Close();
+        return OpenOutputWriter(writer, path);
+    }
+
+    uint64_t BytesWritten() const override { return writer.BytesWritten(); }
+    bool Preallocate(uint64_t bytes) override { return writer.Preallocate(bytes); }
+
+private:
+    static uint8_t* PutByte(uint8_t byte, uint8_t* out)
+    {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        std::memcpy(out, &HexDigitTable[byte], 4);
+#else
+        uint32_t entry = __builtin_bswap32(HexDigitTable[byte]);
+        std::memcpy(out, &entry, 4);
+#endif
+        return out + 3;
+    }
+
+    // `column` bytes are already on the current line
+    void WriteBytes(const uint8_t* bytes, size_t count, unsigned& column)
+    {
+        const size_t maxChunk = 1 << 16;
+        while (count > 0)
+        {
+            size_t chunk = std::min(count, maxChunk);
+            uint8_t* start = writer.Reserve(chunk * 13 / 4 + 8);
+            uint8_t* out = start;
+            size_t n = chunk;
+            for (; n > 0 && column != 0; --n)
+            {
+                out = PutByte(*bytes++, out);
+                if (++column == 4)
+                {
+                    *out++ = '\n';
+                    column = 0;
+                }
+            }
+            for (; n >= 4; n -= 4, bytes += 4)
+            {
+                PutByte(bytes[0], out);
+                PutByte(bytes[1], out + 3);
+                PutByte(bytes[2], out + 6);
+                PutByte(bytes[3], out + 9);  // ends with the line break
+                out += 13;
+            }
+            for (; n > 0; --n)
+            {
+                out = PutByte(*bytes++, out);
+                ++column;
+            }
+            writer.Commit(out - start);
+            count -= chunk;
+        }
+    }
+
+    void WriteIFGs(uint64_t count, unsigned& column)
+    {
+        static const uint8_t ifg[4] = { 0x07, 0x07, 0x07, 0x07 };
+        static const std::string lines = []()
+        {
+            std::string block;
+            for (int i = 0; i < 4096; ++i)
+                block += "07 07 07 07 \n";
+            return block;
+        }();
+        while (count > 0 && column != 0)
+        {
+            WriteBytes(ifg, 1, column);
+            --count;
+        }
+        for (uint64_t whole = count / 4; whole > 0;)
+        {
+            uint64_t chunk = std::min<uint64_t>(whole, 4096);
+            writer.Write(lines.data(), chunk * 13);
+            whole -= chunk;
+        }
+        WriteBytes(ifg, count % 4, column);
+    }
+
+    BufferedFileWriter writer;
+    unsigned column;  // bytes on the current line
+};
+
+// libpcap capture with nanosecond timestamps (magic 0xA1B23C4D), link type Ethernet
+// Records hold the frame from the destination address up to and including the FCS
+class PcapPacketSink : public PacketSink
+{
+public:
+    static const uint32_t MagicNanoseconds = 0xA1B23C4D;
+    static const uint32_t LinkTypeEthernet = 1;
+
+    bool Open(const std::string& path) override
+    {
+        if (!OpenOutputWriter(writer, path))
+        {
+            return false;
+        }
+        writer.WriteValue<uint32_t>(MagicNanoseconds);
+        writer.WriteValue<uint16_t>(2);      // version major
+        writer.WriteValue<uint16_t>(4);      // version minor
+        writer.WriteValue<int32_t>(0);       // thiszone
+        writer.WriteValue<uint32_t>(0);      // sigfigs
+        writer.WriteValue<uint32_t>(65535);  // snaplen
+        writer.WriteValue<uint32_t>(LinkTypeEthernet);
+        return true;
+    }
+
+    void WritePacket(const uint8_t* packet, size_t frameLength, uint64_t timestampNs) override
+    {
+        const size_t preamble = EthernetPacket::PreambleSize;
+        uint32_t length = static_cast<uint32_t>(frameLength - preamble);
+        writer.WriteValue<uint32_t>(static_cast<uint32_t>(timestampNs / 1000000000ull));
+        writer.WriteValue<uint32_t>(static_cast<uint32_t>(timestampNs % 1000000000ull));
+        writer.WriteValue<uint32_t>(length);  // captured length
+        writer.WriteValue<uint32_t>(length);  // original length
+        writer.Write(packet + preamble, length);
+    }
+
+    void Close() override
+    {
+        writer.Close();
+    }
+
+    uint64_t BytesWritten() const override { return writer.BytesWritten(); }
+    bool Preallocate(uint64_t bytes) override { return writer.Preallocate(bytes); }
+
+private:
+    BufferedFileWriter writer;
+};
+
+// pcapng capture: one Ethernet interface with nanosecond resolution and a 4-byte FCS on every packet
+class PcapngPacketSink : public PacketSink
+{
+public:
+    bool Open(const std::string& path) override
+    {
+        if (!OpenOutputWriter(writer, path))
+        {
+            return false;
+        }
+        // Section Header Block
+        writer.WriteValue<uint32_t>(0x0A0D0D0A);
+        writer.WriteValue<uint32_t>(28);
+        writer.WriteValue<uint32_t>(0x1A2B3C4D);     // byte-order magic
+        writer.WriteValue<uint16_t>(1);              // version major
+        writer.WriteValue<uint16_t>(0);              // version minor
+        writer.WriteValue<int64_t>(-1);              // section length not specified
+        writer.WriteValue<uint32_t>(28);
+
+        // Interface Description Block with if_tsresol = 10^-9 and if_fcslen = 4
+        writer.WriteValue<uint32_t>(0x00000001);
+        writer.WriteValue<uint32_t>(40);
+        writer.WriteValue<uint16_t>(PcapPacketSink::LinkTypeEthernet);
+        writer.WriteValue<uint16_t>(0);              // reserved
+        writer.WriteValue<uint32_t>(65535);          // snaplen
+        writer.WriteValue<uint16_t>(9);              // if_tsresol
+        writer.WriteValue<uint16_t>(1);
+        writer.WriteValue<uint32_t>(9);              // value + padding
+        writer.WriteValue<uint16_t>(13);             // if_fcslen
+        writer.WriteValue<uint16_t>(1);
+        writer.WriteValue<uint32_t>(4);              // value + padding
+        writer.WriteValue<uint32_t>(0);              // opt_endofopt
+        writer.WriteValue<uint32_t>(40);
+        return true;
+    }
+
+    void WritePacket(const uint8_t* packet, size_t frameLength, uint64_t timestampNs) override
+    {
+        // Enhanced Packet Block
+        const size_t preamble = EthernetPacket::PreambleSize;
+        uint32_t length = static_cast<uint32_t>(frameLength - preamble);
+        uint32_t padding = (4 - length % 4) % 4;
+        uint32_t blockLength = 32 + length + padding;
+        static const uint8_t zeros[4] = { 0, 0, 0, 0 };
+
+        writer.WriteValue<uint32_t>(0x00000006);
+        writer.WriteValue<uint32_t>(blockLength);
+        writer.WriteValue<uint32_t>(0);              // interface id
+        writer.WriteValue<uint32_t>(static_cast<uint32_t>(timestampNs >> 32));
+        writer.WriteValue<uint32_t>(static_cast<uint32_t>(timestampNs & 0xFFFFFFFF));
+        writer.WriteValue<uint32_t>(length);         // captured length
+        writer.WriteValue<uint32_t>(length);         // original length
+        writer.Write(packet + preamble, length);
+        writer.Write(zeros, padding);
+        writer.WriteValue<uint32_t>(blockLength);
+    }
+
+    void Close() override
+    {
+        writer.Close();
+    }
+
+    uint64_t BytesWritten() const override { return writer.BytesWritten(); }
+    bool Preallocate(uint64_t bytes) override { return writer.Preallocate(bytes); }
+
+private:
+    BufferedFileWriter writer;
+};
+
+#if defined(__linux__)
+// Live transmission out of a network interface through an AF_PACKET socket with a PACKET_TX_RING (TPACKET_V2)
+// Each frame is copied once, from the encoded slot straight into an mmapped ring slot, without preamble/SFD and
+// without the FCS the NIC appends (Output.LiveFCS=1 keeps it). Filled slots are handed to the kernel in batches,
+// each released at the timeline time of its first packet (PacketScheduler: Eth.LineRate, Eth.MinNumOfIFGsPerPacket,
+// bursts and IFG fill), so the link follows the timeline with at most BatchNs of jitter
+class LivePacketSink : public PacketSink
+{
+public:
+    static const uint64_t BatchNs = 20000;
+
+    LivePacketSink() : fd(-1), ring(nullptr), ringBytes(0), frameSize(0), frameCount(0), next(0), unreleased(0),
+                       batchStartNs(0), started(false), sent(0), rejected(0), oversized(0) {}
+
+    ~LivePacketSink() { Shutdown(); }
+
+    bool Open(const std::string& interfaceName) override
+    {
+        interface = interfaceName;
+        fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+        if (fd < 0)
+            return Fail("AF_PACKET socket (needs CAP_NET_RAW)");
+        int version = TPACKET_V2;
+        if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0)
+            return Fail("PACKET_VERSION");
+        int bypass = 1;
+        setsockopt(fd, SOL_PACKET, PACKET_QDISC_BYPASS, &bypass, sizeof(bypass));  // optional, straight to the driver
+
+        // Slots sized for the largest frame, the ring for Output.RingSizeMB (1 MB at least)
+        size_t largest = EthernetPacket::HeaderSize + std::max(MaxPacketSize, 1500) + EthernetPacket::FCSSize;
+        frameSize = 2048;
+        while (frameSize < DataOffset() + largest)
+            frameSize *= 2;
+        size_t blockSize = std::max<size_t>(frameSize, 1 << 16);
+        size_t blocks = std::max<size_t>(1, (std::max(output_ring_mb, 1) * (1ull << 20)) / blockSize);
+        tpacket_req request = {};
+        request.tp_block_size = static_cast<unsigned>(blockSize);
+        request.tp_block_nr = static_cast<unsigned>(blocks);
+        request.tp_frame_size = static_cast<unsigned>(frameSize);
+        request.tp_frame_nr = static_cast<unsigned>(blocks * (blockSize / frameSize));
+        if (setsockopt(fd, SOL_PACKET, PACKET_TX_RING, &request, sizeof(request)) != 0)
+            return Fail("PACKET_TX_RING");
+        frameCount = request.tp_frame_nr;
+        ringBytes = blockSize * blocks;
+
+        sockaddr_ll address = {};
+        address.sll_family = AF_PACKET;
+        address.sll_protocol = htons(ETH_P_ALL);
+        address.sll_ifindex = static_cast<int>(if_nametoindex(interfaceName.c_str()));
+        if (address.sll_ifindex == 0)
+            return Fail("unknown interface");
+        if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+            return Fail("bind");
+
+        void* mapped = mmap(nullptr, ringBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED)
+            return Fail("mmap of the TX ring");
+        ring = static_cast<uint8_t*>(mapped);
+        return true;
+    }
+
+    void WritePacket(const uint8_t* packet, size_t frameLength, uint64_t timestampNs) override
+    {
+        size_t length = frameLength - EthernetPacket::PreambleSize - (output_liveFcs ? 0 : EthernetPacket::FCSSize);
+        if (DataOffset() + length > frameSize)
+        {
+            ++oversized;
+            return;
+        }
+        if (!started)
+        {
+            // the timeline starts with the first packet
+            start = std::chrono::steady_clock::now() - std::chrono::nanoseconds(timestampNs);
+            started = true;
+        }
+        if (unreleased > 0 && (timestampNs - batchStartNs >= BatchNs || unreleased == frameCount))
+            Release();
+
+        tpacket2_hdr* header = Slot(next);
+        WaitForSlot(header);
+        std::memcpy(reinterpret_cast<uint8_t*>(header) + DataOffset(), packet + EthernetPacket::PreambleSize, length);
+        header->tp_len = static_cast<uint32_t>(length);
+        if (unreleased == 0)
+            batchStartNs = timestampNs;
+        ++unreleased;
+        next = (next + 1) % frameCount;
+    }
+
+    void Close() override
+    {
+        if (ring && unreleased > 0)
+            Release();
+        Shutdown();
+        std::cout << "Sent " << sent << " frames out of " << interface;
+        if (rejected + oversized != 0)
+            std::cout << ", " << rejected << " rejected by the kernel, " << oversized << " larger than a ring slot";
+        std::cout << std::endl;
+    }
+
+private:
+    // Frame data follows the tpacket2_hdr, like the sockaddr_ll of a received frame
+    static size_t DataOffset() { return TPACKET2_HDRLEN - sizeof(sockaddr_ll); }
+
+    tpacket2_hdr* Slot(size_t index) { return reinterpret_cast<tpacket2_hdr*>(ring + index * frameSize); }
+
+    bool Fail(const char* what)
+    {
+        std::cerr << "Live output on " << interface << ": " << what << ": " << std::strerror(errno) << std::endl;
+        Shutdown();
+        return false;
+    }
+
+    // Hand the filled slots to the kernel once the first one is due
+    void Release()
+    {
+        auto due = start + std::chrono::nanoseconds(batchStartNs);
+        for (auto now = std::chrono::steady_clock::now(); now < due; now = std::chrono::steady_clock::now())
+        {
+            if (due - now > std::chrono::microseconds(200))
+                std::this_thread::sleep_for(due - now - std::chrono::microseconds(100));
+        }
+        size_t index = (next + frameCount - unreleased) % frameCount;
+        for (size_t n = 0; n < unreleased; ++n, index = (index + 1) % frameCount)
+        {
+            __atomic_store_n(&Slot(index)->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+        }
+        sent += unreleased;
+        unreleased = 0;
+        send(fd, nullptr, 0, MSG_DONTWAIT);
+    }
+
+    // The slot is free once the kernel has sent its previous frame
+    void WaitForSlot(tpacket2_hdr* header)
+    {
+        while (true)
+        {
+            uint32_t status = __atomic_load_n(&header->tp_status, __ATOMIC_ACQUIRE);
+            if (status == TP_STATUS_AVAILABLE)
+                return;
+            if (status & TP_STATUS_WRONG_FORMAT)
+            {
+                ++rejected;
+                __atomic_store_n(&header->tp_status, TP_STATUS_AVAILABLE, __ATOMIC_RELEASE);
+                return;
+            }
+            send(fd, nullptr, 0, MSG_DONTWAIT);
+            pollfd writable = { fd, POLLOUT, 0 };
+            poll(&writable, 1, 1);
+        }
+    }
+
+    // Wait for the kernel to send the released frames, then unmap the ring and close the socket
+    void Shutdown()
+    {
+        if (ring)
+        {
+            send(fd, nullptr, 0, 0);
+            for (size_t index = 0; index < frameCount; ++index)
+            {
+                for (int tries = 0; tries < 1000; ++tries)
+                {
+                    uint32_t status = __atomic_load_n(&Slot(index)->tp_status, __ATOMIC_ACQUIRE);
+                    if (status & TP_STATUS_WRONG_FORMAT)
+                    {
+                        ++rejected;
+                        break;
+                    }
+                    if (status == TP_STATUS_AVAILABLE)
+                        break;
+                    send(fd, nullptr, 0, MSG_DONTWAIT);
+                    pollfd writable = { fd, POLLOUT, 0 };
+                    poll(&writable, 1, 1);
+                }
+            }
+            munmap(ring, ringBytes);
+            ring = nullptr;
+        }
+        if (fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    std::string interface;
+    int fd;
+    uint8_t* ring;
+    size_t ringBytes;
+    size_t frameSize;
+    size_t frameCount;
+    size_t next;              // slot the next frame goes to
+    size_t unreleased;        // filled slots before `next` not yet handed to the kernel
+    uint64_t batchStartNs;    // timeline time of the first unreleased frame
+    bool started;
+    std::chrono::steady_clock::time_point start;  // wall-clock time of timeline 0
+    uint64_t sent, rejected, oversized;
+};
+#endif
+
+// Create the sink for Output.Format, nullptr if the format is unknown
+std::unique_ptr<PacketSink> CreatePacketSink(const std::string& format)
+{
+    if (format == "text")
+        return std::unique_ptr<PacketSink>(new TextPacketSink());
+    if (format == "pcap")
+        return std::unique_ptr<PacketSink>(new PcapPacketSink());
+    if (format == "pcapng")
+        return std::unique_ptr<PacketSink>(new PcapngPacketSink());
+#if defined(__linux__)
+    if (format == "live")
+        return std::unique_ptr<PacketSink>(new LivePacketSink());
+#endif
+    return nullptr;
+}
+
+// Default output file name for each format, in `directory` (the setup file's directory, as for ORAN.Payload)
+std::string DefaultOutputFile(const std::string& format, const std::string& directory)
+{
+    if (format == "text")
+        return directory + "OutputPackets.txt";
+    return directory + "OutputPackets." + format;
+}
+
+// Output.SegmentMB / Output.SegmentMs: the capture goes to <output>.0, <output>.1, ..., each a complete capture of
+// whole radio frames with its own file header, so consecutive segments merge back into one with the Merge tool.
+// A segment ends before the radio frame that would take it past Output.SegmentMB (the frame before tells the size)
+// or after Output.SegmentMs of capture time; with Output.SegmentCount=N only the last N segments stay on disk
+class OutputRotation
+{
+public:
+    void Configure(const std::string& path, int segmentMb, int segmentMs, int keepCount)
+    {
+        basePath = path;
+        capBytes = segmentMb > 0 ? static_cast<uint64_t>(segmentMb) << 20 : 0;
+        framesPerSegment = segmentMs > 0 ? std::max(1, segmentMs / 10) : 0;
+        keep = std::max(keepCount, 0);
+        segment = 0;
+        framesInSegment = 0;
+        frameStart = lastFrameBytes = previousBytes = 0;
+    }
+
+    bool Enabled() const { return capBytes != 0 || framesPerSegment != 0; }
+
+    std::string SegmentPath(uint64_t index) const { return basePath + "." + std::to_string(index); }
+    std::string CurrentPath() const { return SegmentPath(segment); }
+    uint64_t Segments() const { return segment + 1; }                                        // written so far
+    uint64_t FirstKept() const { return keep != 0 && segment >= keep ? segment + 1 - keep : 0; }
+
+    // Open the first segment
+    bool Open(PacketSink& sink)
+    {
+        if (!sink.Open(CurrentPath()))
+            return false;
+        Preallocate(sink);
+        return true;
+    }
+
+    // Called before every radio frame: move on to the next segment if the current one is full. False if the next
+    // segment cannot be opened
+    bool BeginFrame(PacketSink& sink)
+    {
+        uint64_t written = sink.BytesWritten();
+        if (framesInSegment > 0)
+        {
+            lastFrameBytes = written - frameStart;
+            bool full = (framesPerSegment != 0 && framesInSegment >= framesPerSegment) ||
+                        (capBytes != 0 && written + lastFrameBytes > capBytes);
+            if (full)
+            {
+                previousBytes = written;
+                if (!sink.Rotate(SegmentPath(++segment)))
+                    return false;
+                if (keep != 0 && segment >= keep)
+                    std::remove(SegmentPath(segment - keep).c_str());
+                Preallocate(sink);
+                framesInSegment = 0;
+                written = sink.BytesWritten();
+            }
+        }
+        frameStart = written;
+        ++framesInSegment;
+        return true;
+    }
+
+private:
+    // the cap, or the size of the segment before when only the capture time is capped
+    void Preallocate(PacketSink& sink)
+    {
+        uint64_t bytes = capBytes != 0 ? capBytes : previousBytes;
+        if (bytes != 0)
+            sink.Preallocate(bytes);
+    }
+
+    std::string basePath;
+    uint64_t capBytes = 0;
+    int framesPerSegment = 0;
+    uint64_t keep = 0;
+    uint64_t segment = 0;          // index of the segment being written
+    int framesInSegment = 0;
+    uint64_t frameStart = 0;       // bytes of the segment before the current radio frame
+    uint64_t lastFrameBytes = 0;
+    uint64_t previousBytes = 0;    // size of the segment before
+};
+
+// Reads back a capture written by one of the packet sinks, for the companion tools
+// The file is memory-mapped and its format recognized from the first bytes: pcap, pcapng, or else the text dump.
+// It is read in windows of a few MB, so memory does not grow with the capture: NextWindow() reads the next one and
+// indexes the frames that end in it, from the destination address up to the FCS. A compressed capture (LZ4 or zstd
+// frames with a seek table, see CaptureCompression) has the blocks of a window decoded on `threads` threads; one
+// without a seek table (e.g. from the lz4 tool) is decompressed whole first. A text capture is decoded to bytes a
+// window at a time, split at line boundaries across `threads` threads; its frames are then found from the preamble
+// and the eCPRI size. Load() makes indexed frames readable again, for tools that visit them out of order
+class CaptureReader
+{
+public:
+    enum Format { Text, Pcap, Pcapng };
+
+    struct Frame
+    {
+        size_t offset;          // in the capture, decoded if it is text
+        uint32_t length;        // destination address up to the FCS
+        uint64_t timestampNs;   // pcap and pcapng
+        uint64_t ifgsBefore;    // IFG bytes since the previous frame (text)
+    };
+
+    // False if the file cannot be read. Nothing is indexed yet: see NextWindow()
+    bool Open(const std::string& path, unsigned threads = 1)
+    {
+        this->threads = std::max(1u, threads);
+        frames.clear();
+        blocks.clear();
+        unpacked.clear();
+        sourceBuffer.clear();
+        decoded.clear();
+        checkpoints.clear();
+        resolution.clear();
+        error.clear();
+        format = Text;
+        source = nullptr;
+        sourceSize = scanned = next = 0;
+        blocksFirst = blocksLast = 0;
+        decodedOffset = 0;
+        windowFirst = windowLast = 0;
+        window = chunk = nullptr;
+        windowOffset = chunkSize = 0;
+        pendingIFGs = trailingIFGs = 0;
+        if (!file.Open(path))
+        {
+            return false;
+        }
+        source = file.Data();
+        sourceSize = file.Size();
+        uint32_t magic = sourceSize >= 4 ? Read32(source) : 0;
+
+        // Output.Compression: the blocks of each window are decoded when it is read
+        if (CaptureCompression::IsCompressed(magic))
+        {
+            if (CaptureCompression::ReadSeekTable(file.Data(), file.Size(), blocks))
+            {
+                source = nullptr;
+                sourceSize = blocks.empty() ? 0 : blocks.back().outOffset + blocks.back().decompressed;
+            }
+            else if (CaptureCompression::Decompress(file.Data(), file.Size(), this->threads, unpacked, error))
+            {
+                source = unpacked.data();
+                sourceSize = unpacked.size();
+            }
+            else
+            {
+                error = "compressed capture: " + error;
+                sourceSize = 0;
+                return true;
+            }
+            const uint8_t* head;
+            if (!ReadSource(0, std::min<size_t>(sourceSize, 4), head))
+                return true;
+            magic = sourceSize >= 4 ? Read32(head) : 0;
+        }
+        if (magic == 0xA1B23C4D || magic == 0xA1B2C3D4)
+        {
+            format = Pcap;
+            nsPerTick = magic == 0xA1B23C4D ? 1 : 1000;
+        }
+        else if (magic == 0x0A0D0D0A)
+        {
+            format = Pcapng;
+        }
+        return true;
+    }
+
+    // Read the next window and index the frames that end in it, WindowFrames(); their FrameData() stays valid until
+    // the next call. False once the whole capture is read, or after Error()
+    bool NextWindow()
+    {
+        windowFirst = windowLast = frames.size();
+        chunk = nullptr;
+        chunkSize = 0;
+        if (!error.empty() || scanned == sourceSize)
+            return false;
+        if (format == Text)
+        {
+            // the decoded bytes of a frame that did not end in the last window are kept
+            DropDecoded(next);
+            if (!DecodeTextPiece())
+                return false;
+            window = decoded.data();
+            windowOffset = decodedOffset;
+            next = IndexText(next, scanned == sourceSize);
+        }
+        else
+        {
+            // the bytes of a record that did not end in the last window are read again
+            const size_t end = WindowEnd(scanned);
+            const uint8_t* bytes;
+            if (!ReadSource(next, end, bytes))
+                return false;
+            window = bytes;
+            windowOffset = next;
+            chunk = bytes + (scanned - next);
+            chunkSize = end - scanned;
+            scanned = end;
+            next = format == Pcap ? IndexPcap(next, end) : IndexPcapng(next, end);
+        }
+        windowLast = frames.size();
+        return true;
+    }
+
+    // Make frames [first, last), indexed by earlier windows, readable with FrameData() again until the next call; for
+    // use once the capture is read. Memory follows the bytes the frames span. False if the capture cannot be read there
+    bool Load(size_t first, size_t last)
+    {
+        if (first >= last)
+            return true;
+        const size_t begin = frames[first].offset;
+        const size_t end = frames[last - 1].offset + frames[last - 1].length;
+        if (format != Text)
+        {
+            const uint8_t* bytes;
+            if (!ReadSource(begin, end, bytes))
+                return false;
+            window = bytes;
+            windowOffset = begin;
+            return true;
+        }
+        // text: decoded again from the last line boundary before `begin`, unless the decoded bytes still hold it
+        if (begin < decodedOffset || begin > decodedOffset + decoded.size())
+        {
+            auto checkpoint = std::upper_bound(checkpoints.begin(), checkpoints.end(), begin,
+                                               [](size_t offset, const TextCheckpoint& c) { return offset < c.decoded; }) - 1;
+            decoded.clear();
+            decodedOffset = checkpoint->decoded;
+            scanned = checkpoint->text;
+        }
+        else
+        {
+            DropDecoded(begin);
+        }
+        while (decodedOffset + decoded.size() < end)
+        {
+            if (!DecodeTextPiece())
+                return false;
+        }
+        window = decoded.data();
+        windowOffset = decodedOffset;
+        return true;
+    }
+
+    Format GetFormat() const { return format; }
+    const uint8_t* FrameData(const Frame& frame) const { return window + (frame.offset - windowOffset); }
+    const std::vector<Frame>& Frames() const { return frames; }  // every frame indexed so far
+    size_t WindowFirst() const { return windowFirst; }           // frames [WindowFirst(), WindowLast()) of the window
+    size_t WindowLast() const { return windowLast; }
+    size_t FileSize() const { return file.Size(); }
+    // The part of the capture file, decompressed if it was compressed, read by the last NextWindow(): the chunks of
+    // all the windows make up the whole file
+    const uint8_t* ChunkBytes() const { return chunk; }
+    size_t ChunkSize() const { return chunkSize; }
+    uint64_t TrailingIFGs() const { return trailingIFGs; }  // text: IFG bytes after the last frame
+    const std::string& Error() const { return error; }
+
+    static const char* FormatName(Format format)
+    {
+        return format == Text ? "text" : format == Pcap ? "pcap" : "pcapng";
+    }
+
+private:
+    // Start of a piece of the text capture, on a line boundary, and of its bytes once decoded
+    struct TextCheckpoint
+    {
+        size_t decoded;
+        size_t text;
+    };
+
+    static uint32_t Read32(const uint8_t* p)
+    {
+        uint32_t value;
+        std::memcpy(&value, p, 4);
+        return value;
+    }
+
+    static uint16_t Read16(const uint8_t* p)
+    {
+        uint16_t value;
+        std::memcpy(&value, p, 2);
+        return value;
+    }
+
+    // Returns `offset`, to end the indexing there
+    size_t Fail(const std::string& what, size_t offset)
+    {
+        std::ostringstream message;
+        message << what << " at byte " << offset << (format == Text ? " of the decoded text" : "");
+        error = message.str();
+        return offset;
+    }
+
+    const uint8_t* At(size_t offset) const { return window + (offset - windowOffset); }
+
+    // End of the window that starts at `offset` of the capture file: 4 blocks per thread, whole blocks if it is
+    // compressed
+    size_t WindowEnd(size_t offset) const
+    {
+        size_t end = std::min(sourceSize, offset + 4 * threads * CaptureCompression::MaxBlockSize);
+        if (!blocks.empty() && end < sourceSize)
+        {
+            auto block = std::upper_bound(blocks.begin(), blocks.end(), end - 1,
+                                          [](size_t at, const CaptureCompression::SeekEntry& b) { return at < b.outOffset; }) - 1;
+            end = block->outOffset + block->decompressed;
+        }
+        return end;
+    }
+
+    // Bytes [begin, end) of the capture file, decompressed. Of a compressed file, the blocks decoded by the last call
+    // from the one holding `begin` on are kept, and the others decoded on `threads` threads. False with Error() set
+    // if a block does not decode
+    bool ReadSource(size_t begin, size_t end, const uint8_t*& bytes)
+    {
+        if (source || begin >= end)
+        {
+            bytes = source ? source + begin : sourceBuffer.data();
+            return true;
+        }
+        auto holding = [this](size_t at)
+        {
+            return static_cast<size_t>(std::upper_bound(blocks.begin(), blocks.end(), at,
+                                                        [](size_t offset, const CaptureCompression::SeekEntry& b) { return offset < b.outOffset; }) -
+                                       blocks.begin()) - 1;
+        };
+        const size_t first = holding(begin), last = holding(end - 1) + 1;
+        if (first >= blocksFirst && first < blocksLast)
+        {
+            const size_t drop = blocks[first].outOffset - blocks[blocksFirst].outOffset;
+            sourceBuffer.erase(sourceBuffer.begin(), sourceBuffer.begin() + drop);
+            blocksFirst = first;
+        }
+        else
+        {
+            sourceBuffer.clear();
+            blocksFirst = blocksLast = first;
+        }
+        if (last > blocksLast)
+        {
+            const size_t kept = sourceBuffer.size();
+            sourceBuffer.resize(blocks[last - 1].outOffset + blocks[last - 1].decompressed - blocks[blocksFirst].outOffset);
+            if (!CaptureCompression::DecodeFrames(file.Data(), blocks, blocksLast, last, threads, sourceBuffer.data() + kept, error))
+            {
+                error = "compressed capture: " + error;
+                sourceBuffer.clear();
+                blocksFirst = blocksLast = 0;
+                return false;
+            }
+            blocksLast = last;
+        }
+        bytes = sourceBuffer.data() + (begin - blocks[blocksFirst].outOffset);
+        return true;
+    }
+
+    // Index the pcap records from `pos` that end before `end`; returns where the next window resumes
+    size_t IndexPcap(size_t pos, size_t end)
+    {
+        if (pos == 0)
+        {
+            if (sourceSize < 24)
+                return Fail("truncated pcap header", 0);
+            pos = 24;
+        }
+        while (pos < end)
+        {
+            if (sourceSize - pos < 16)
+                return Fail("truncated record header", pos);
+            if (end - pos < 16)
+                break;
+            uint32_t captured = Read32(At(pos) + 8);
+            if (captured > sourceSize - pos - 16)
+                return Fail("truncated record", pos);
+            if (captured > end - pos - 16)
+                break;
+            uint64_t timestamp = Read32(At(pos)) * 1000000000ull + Read32(At(pos) + 4) * nsPerTick;
+            frames.push_back({ pos + 16, captured, timestamp, 0 });
+            pos += 16 + captured;
+        }
+        return pos;
+    }
+
+    // Index the pcapng blocks from `pos` that end before `end`; returns where the next window resumes
+    size_t IndexPcapng(size_t pos, size_t end)
+    {
+        while (pos < end)
+        {
+            if (sourceSize - pos < 12)
+                return Fail("truncated block header", pos);
+            if (end - pos < 12)
+                break;
+            uint32_t type = Read32(At(pos));
+            uint32_t length = Read32(At(pos) + 4);
+            if (length < 12 || length % 4 != 0 || length > sourceSize - pos)
+                return Fail("bad block length", pos);
+            if (length > end - pos)
+                break;
+            if (Read32(At(pos) + length - 4) != length)
+                return Fail("bad block length", pos);
+            const uint8_t* body = At(pos) + 8;
+            if (type == 0x0A0D0D0A)
+            {
+                if (length < 28 || Read32(body) != 0x1A2B3C4D)
+                    return Fail("unsupported section byte order", pos);
+                resolution.clear();
+            }
+            else if (type == 0x00000001)
+            {
+                uint32_t digits = 6;
+                for (size_t option = 8; option + 4 <= length - 12;)
+                {
+                    uint16_t code = Read16(body + option), optionLength = Read16(body + option + 2);
+                    if (code == 0)
+                        break;
+                    if (code == 9 && optionLength >= 1 && (body[option + 4] & 0x80) == 0)
+                        digits = body[option + 4];
+                    option += 4 + (optionLength + 3) / 4 * 4;
+                }
+                resolution.push_back(digits);
+            }
+            else if (type == 0x00000006)
+            {
+                if (length < 32)
+                    return Fail("truncated packet block", pos);
+                uint32_t interface = Read32(body);
+                uint32_t captured = Read32(body + 12);
+                if (interface >= resolution.size() || captured > length - 32)
+                    return Fail("bad packet block", pos);
+                uint64_t ticks = (static_cast<uint64_t>(Read32(body + 4)) << 32) | Read32(body + 8);
+                uint64_t timestamp = ticks;
+                for (uint32_t d = resolution[interface]; d < 9; ++d)
+                    timestamp *= 10;
+                for (uint32_t d = resolution[interface]; d > 9; --d)
+                    timestamp /= 10;
+                frames.push_back({ pos + 28, captured, timestamp, 0 });
+            }
+            pos += length;
+        }
+        return pos;
+    }
+
+    // Forget the decoded text before `offset`
+    void DropDecoded(size_t offset)
+    {
+        decoded.erase(decoded.begin(), decoded.begin() + (offset - decodedOffset));
+        decodedOffset = offset;
+    }
+
+    // Decode the text from `scanned` up to the end of its window, or of the last whole line in it, after the decoded
+    // bytes kept. A line longer than a window makes the window longer
+    bool DecodeTextPiece()
+    {
+        if (scanned == sourceSize)
+            return false;
+        const uint8_t* text;
+        size_t end = scanned, cut = scanned;
+        while (cut == scanned)
+        {
+            end = WindowEnd(end);
+            if (!ReadSource(scanned, end, text))
+                return false;
+            const void* newline = end < sourceSize ? memrchr(text, '\n', end - scanned) : nullptr;
+            cut = end < sourceSize ? (newline ? scanned + (static_cast<const uint8_t*>(newline) - text) + 1 : scanned) : end;
+        }
+        if (checkpoints.empty() || checkpoints.back().text < scanned)
+            checkpoints.push_back({ decodedOffset + decoded.size(), scanned });
+        DecodeText(reinterpret_cast<const char*>(text), cut - scanned);
+        chunk = text;
+        chunkSize = cut - scanned;
+        scanned = cut;
+        return true;
+    }
+
+    // Text capture: "hh " bytes in lines; lines holding anything else ("Frame : n", "Sending IFGs ...") are skipped.
+    // The bytes are appended to `decoded`
+    void DecodeText(const char* text, size_t size)
+    {
+        const size_t minChunk = 4 << 20;
+        size_t chunks = std::max<size_t>(1, std::min<size_t>(threads, size / minChunk));
+        std::vector<const char*> bounds(1, text);
+        for (size_t c = 1; c < chunks; ++c)
+        {
+            const char* cut = std::max(text + size * c / chunks, bounds.back());
+            const char* newline = static_cast<const char*>(std::memchr(cut, '\n', text + size - cut));
+            bounds.push_back(newline ? newline + 1 : text + size);
+        }
+        bounds.push_back(text + size);
+
+        std::vector<std::vector<uint8_t>> parts(chunks);
+        std::vector<std::thread> workers;
+        for (size_t c = 0; c < chunks; ++c)
+        {
+            auto work = [&, c]() { DecodeHexChunk(bounds[c], bounds[c + 1], parts[c]); };
+            if (c + 1 < chunks)
+                workers.emplace_back(work);
+            else
+                work();
+        }
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+        size_t total = decoded.size();
+        for (const std::vector<uint8_t>& part : parts)
+            total += part.size();
+        decoded.reserve(total);
+        for (const std::vector<uint8_t>& part : parts)
+            decoded.insert(decoded.end(), part.begin(), part.end());
+    }
+
+    static void DecodeHexChunk(const char* p, const char* end, std::vector<uint8_t>& out)
+    {
+        static constexpr std::array<int8_t, 256> hex = []()
+        {
+            std::array<int8_t, 256> table{};
+            for (int c = 0; c < 256; ++c)
+                table[c] = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                         : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+            return table;
+        }();
+        out.reserve((end - p) / 3 + 1);
+        while (p < end)
+        {
+            const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (!lineEnd)
+                lineEnd = end;
+            while (p < lineEnd)
+            {
+                if (*p == ' ' || *p == '\r')
+                {
+                    ++p;
+                    continue;
+                }
+                int high = hex[static_cast<uint8_t>(p[0])];
+                int low = p + 1 < lineEnd ? hex[static_cast<uint8_t>(p[1])] : -1;
+                if (high < 0 || low < 0 || (p + 2 < lineEnd && p[2] != ' ' && p[2] != '\r'))
+                    break;  // not a line of bytes
+                out.push_back(static_cast<uint8_t>(high << 4 | low));
+                p += 2;
+            }
+            p = lineEnd + 1;
+        }
+    }
+
+    // Length of the run of IFG bytes (0x07) at p
+    static size_t CountIFGs(const uint8_t* p, size_t size)
+    {
+        size_t n = 0;
+#if defined(__SSE2__)
+        const __m128i ifg = _mm_set1_epi8(0x07);
+        for (; n + 16 <= size; n += 16)
+        {
+            int equal = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + n)), ifg));
+            if (equal != 0xFFFF)
+                return n + __builtin_ctz(~equal);
+        }
+#endif
+        while (n < size && p[n] == 0x07)
+            ++n;
+        return n;
+    }
+
+    // Index the text frames from `pos` that end in the decoded bytes; a frame cut by the end of the window waits for
+    // the next one, unless it is the `last`. Returns where the next window resumes
+    size_t IndexText(size_t pos, bool last)
+    {
+        static const uint8_t preamble[8] = { 0xFB, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0xD5 };
+        const size_t headerEnd = EthernetPacket::PayloadOffset + eCPRI_Packet::HeaderSize;
+        const size_t size = decodedOffset + decoded.size();
+        while (pos < size)
+        {
+            size_t gap = CountIFGs(At(pos), size - pos);
+            pendingIFGs += gap;
+            pos += gap;
+            if (pos == size)
+                break;
+            if (size - pos < headerEnd)
+                return last ? Fail("truncated frame", pos) : pos;
+            if (std::memcmp(At(pos), preamble, sizeof(preamble)) != 0)
+                return Fail("missing preamble/SFD", pos);
+            size_t ecpriSize = static_cast<size_t>(At(pos)[EthernetPacket::PayloadOffset + 2]) << 8 |
+                               At(pos)[EthernetPacket::PayloadOffset + 3];
+            size_t length = EthernetPacket::HeaderSize + eCPRI_Packet::HeaderSize + ecpriSize + EthernetPacket::FCSSize;
+            if (size - pos - EthernetPacket::PreambleSize < length)
+                return last ? Fail("truncated frame", pos) : pos;
+            frames.push_back({ pos + EthernetPacket::PreambleSize, static_cast<uint32_t>(length), 0, pendingIFGs });
+            pendingIFGs = 0;
+            pos += EthernetPacket::PreambleSize + length;
+        }
+        if (last)
+            trailingIFGs = pendingIFGs;
+        return pos;
+    }
+
+    MappedFile file;
+    unsigned threads = 1;
+    Format format = Text;
+    uint64_t nsPerTick = 1000;                             // pcap
+    std::vector<uint32_t> resolution;                      // pcapng: if_tsresol of each interface, as a power of ten
+    // The capture file, decompressed: in place if `source` is set, else from the blocks of the seek table, those from
+    // blocksFirst to blocksLast decoded in sourceBuffer
+    const uint8_t* source = nullptr;
+    size_t sourceSize = 0;
+    std::vector<uint8_t> unpacked;                         // a compressed file without a seek table, decompressed whole
+    std::vector<CaptureCompression::SeekEntry> blocks;
+    std::vector<uint8_t> sourceBuffer;
+    size_t blocksFirst = 0, blocksLast = 0;
+    size_t scanned = 0;                                    // bytes of the capture file read
+    size_t next = 0;                                       // where the indexing resumes, in the capture (decoded text)
+    std::vector<uint8_t> decoded;                          // text: decoded bytes from decodedOffset on
+    size_t decodedOffset = 0;
+    std::vector<TextCheckpoint> checkpoints;
+    // The bytes FrameData() reads, from windowOffset on, and the last chunk of the file read
+    const uint8_t* window = nullptr;
+    size_t windowOffset = 0;
+    const uint8_t* chunk = nullptr;
+    size_t chunkSize = 0;
+    size_t windowFirst = 0, windowLast = 0;
+    std::vector<Frame> frames;
+    uint64_t pendingIFGs = 0;
+    uint64_t trailingIFGs = 0;
+    std::string error;
+};
+
+#ifndef MILESTONE2_NO_MAIN
+// Gen.Continuous=1 runs until SIGINT or SIGTERM; the run then stops at the next radio frame boundary and closes the
+// output as at the end of a capture
+static volatile std::sig_atomic_t stopRequested = 0;
+
+static void RequestStop(int)
+{
+    stopRequested = 1;
+}
+
+int main(int argc, char* argv[])
+{
+    //  Load setup file and iq file
+    std::string setupFilePath = "SetupFile.txt";
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--setup" && i + 1 < argc)
+            setupFilePath = argv[++i];
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--setup SetupFile.txt]" << std::endl;
+            return 1;
+        }
+    }
+    GeneratorConfig config;
+    if (!config.Load(setupFilePath))
+    {
+        return 1;
+    }
+    config.Publish();
+
+    std::cout << "Setup file parameters loaded successfully." << std::endl;
+
+    // Payloads, streams, slot encoder and timeline; relative ORAN.Payload files are next to the setup file
+    PacketGenerator source;
+    std::string error;
+    if (!source.Open(config, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    // Calculations for frames , subframes , ... etc calculations, for a setup Open() accepted
+    Calculations();
+    const CaptureGenerator& generator = source.Generic();
+    if (!generator.Compression().Legacy())
+    {
+        std::cout << "IQ compression " << oran_compMethod << " " << oran_iqWidth << "-bit: " << generator.Compression().PRBBytes()
+                  << " bytes per PRB instead of " << IQSampleStore::BytesPerPRB << std::endl;
+    }
+    if (gen_mode == "template" && !generator.UseTemplates())
+    {
+        std::cout << "Gen.Mode=template needs ORAN.PayloadType=fixed, encoding every frame instead." << std::endl;
+    }
+    const SlotEncoder& slotEncoder = source.Encoder();
+    std::cout << "Slot encoder: " << slotEncoder.Name() << std::endl;
+    const int packetsPerSymbol = static_cast<int>(generator.Layout().size());
+    const int lastStream = static_cast<int>(generator.StreamCount()) - 1;
+    PacketScheduler& scheduler = source.Scheduler();
+
+    // Output to file
+    std::unique_ptr<PacketSink> OutputFile = CreatePacketSink(output_format);
+    if (!OutputFile)
+    {
+        std::cerr << "Unknown output format: " << output_format << std::endl;
+        return 1;
+    }
+
+    // the live sink takes the interface name
+    // Gen.Shard=i/N: radio frames [i F / N, (i + 1) F / N) of the F frames go to the segment file <output>.shard<i>,
+    // the Merge tool joins the segments
+    const int shardIndex = source.ShardIndex(), shardCount = source.ShardCount();
+    if (shardCount > 1 && output_format == "live")
+    {
+        std::cerr << "Gen.Shard needs a file output format." << std::endl;
+        return 1;
+    }
+    const uint64_t firstFrame = source.FirstFrame();
+    const uint64_t endFrame = source.EndFrame();
+    const bool continuous = source.Continuous();
+
+    // Output.SegmentMB / Output.SegmentMs rotate the output file into segments <output>.0, <output>.1, ...
+    OutputRotation rotation;
+    if ((output_segment_mb > 0 || output_segment_ms > 0) && output_format == "live")
+    {
+        std::cerr << "Output.SegmentMB and Output.SegmentMs need a file output format." << std::endl;
+        return 1;
+    }
+
+    std::string outputFilePath = output_format == "live" ? output_interface
+                               : output_file.empty() ? DefaultOutputFile(output_format, config.directory) : output_file;
+
+    // Output.Compression: the file is written as LZ4 or zstd blocks, named with the extension of the method
+    CaptureCompression compression;
+    if (!CaptureCompression::Parse(output_compression, output_compression_level, output_compression_threads, compression))
+    {
+        std::cerr << "Unsupported output compression: " << output_compression
+                  << (output_compression == "zstd" ? " (build with -DMILESTONE2_WITH_ZSTD -lzstd)" : "") << std::endl;
+        return 1;
+    }
+    if (compression.Enabled())
+    {
+        if (output_format == "live")
+        {
+            std::cerr << "Output.Compression needs a file output format." << std::endl;
+            return 1;
+        }
+        outputFilePath += compression.Extension();
+        std::cout << "Output compressed with " << compression.Name() << " in " << (CaptureCompression::MaxBlockSize >> 20)
+                  << " MB blocks on " << compression.threads << " threads" << std::endl;
+    }
+    if (shardCount > 1)
+    {
+        outputFilePath += ".shard" + std::to_string(shardIndex);
+        if (!stats_file.empty())
+            stats_file += ".shard" + std::to_string(shardIndex);
+        if (!stats_trace.empty())
+            stats_trace += ".shard" + std::to_string(shardIndex);
+    }
+    rotation.Configure(outputFilePath, output_segment_mb, output_segment_ms, output_segment_count);
+    if (rotation.Enabled() ? !rotation.Open(*OutputFile) : !OutputFile->Open(outputFilePath))
+    {
+        std::cerr << "Error opening output file." << std::endl;
+        return 1;
+    }
+    const uint64_t slotsPerFrame = source.SlotsPerFrame();
+    if (continuous)
+    {
+        std::signal(SIGINT, RequestStop);
+        std::signal(SIGTERM, RequestStop);
+        std::cout << "Continuous run: generating until SIGINT or SIGTERM" << std::endl;
+    }
+
+    // Slots are encoded on the pool (per-slot tasks) and written in order; at most `window` slots are in flight
+    unsigned threads = gen_threads > 0 ? gen_threads : std::max(1u, std::thread::hardware_concurrency());
+    const uint64_t firstSlot = firstFrame * slotsPerFrame;
+    const uint64_t endSlot = endFrame * slotsPerFrame;
+    uint64_t stopSlot = endSlot;  // the slot a stop or an output error ended the run before
+    const size_t window = threads > 1 ? 4 * threads : 1;
+    std::vector<PacketBatch> batches(window);
+    std::vector<EncoderState> encoderStates(threads);
+    std::vector<char> ready(window, 0);
+    std::mutex readyLock;
+    std::condition_variable readyChanged;
+    // declared last so the workers are joined before the state they use goes away
+    std::unique_ptr<WorkStealingPool> pool;
+    if (threads > 1)
+    {
+        pool.reset(new WorkStealingPool(threads));
+    }
+
+    // Encoding workers record as threads 0 .. threads - 1, the writer (this thread) as `threads`
+    RunStatistics stats;
+    stats.Start(threads + 1, !stats_trace.empty());
+    const unsigned writerThread = threads;
+
+    auto encodeSlot = [&](uint64_t slot, unsigned worker)
+    {
+        uint64_t frameId = slot / slotsPerFrame;
+        int subframeId = static_cast<int>(slot % slotsPerFrame / source.SlotsPerSubframe());
+        int slotId = static_cast<int>(slot % source.SlotsPerSubframe());
+        uint64_t begin = CycleCounter::Now();
+        slotEncoder.EncodeSlot(frameId, subframeId, slotId, encoderStates[worker], batches[slot % window]);
+        stats.Record(worker, RunStatistics::Encode, begin, slot);
+        {
+            std::lock_guard<std::mutex> guard(readyLock);
+            ready[slot % window] = 1;
+        }
+        readyChanged.notify_all();
+    };
+    for (uint64_t slot = firstSlot; pool && slot < std::min(firstSlot + window, endSlot); ++slot)
+    {
+        pool->Submit([&, slot](unsigned worker) { encodeSlot(slot, worker); });
+    }
+
+// Loop through frames, subframes, slots, and symbols
+int status = 0;
+for (uint64_t slot = firstSlot; slot < endSlot; ++slot)
+{
+    uint64_t frameId = slot / slotsPerFrame;
+    if (slot % slotsPerFrame == 0)
+    {
+        if (stopRequested)
+        {
+            stopSlot = slot;
+            break;
+        }
+        if (rotation.Enabled() && !rotation.BeginFrame(*OutputFile))
+        {
+            std::cerr << "Error opening output file " << rotation.CurrentPath() << std::endl;
+            status = 1;
+            stopSlot = slot;
+            break;
+        }
+        OutputFile->BeginFrame(frameId);
+    }
+
+    if (pool)
+    {
+        uint64_t begin = CycleCounter::Now();
+        std::unique_lock<std::mutex> guard(readyLock);
+        readyChanged.wait(guard, [&]() { return ready[slot % window] != 0; });
+        guard.unlock();
+        stats.Record(writerThread, RunStatistics::Wait, begin, slot);
+    }
+    else
+    {
+        encodeSlot(slot, 0);
+    }
+
+    // since one ethernet packet carries one ecrpi instance whcih in return contains one oran instance
+    // Therefore numbr of generated ethernet packets = number of generated ecpri packets = number of generated oran packets
+    PacketBatch& batch = batches[slot % window];
+    RunStatistics::Tally& tally = stats.Counts();
+    uint64_t writeBegin = CycleCounter::Now();
+    const int slotInFrame = static_cast<int>(slot % slotsPerFrame);
+    uint64_t frameFill = 0;
+    for (PacketBatch::Packet& packet : batch.packets)
+    {
+        uint64_t fill;
+        bool endsUnit;
+        packet.timestampNs = scheduler.SchedulePacket(packet, frameId, slotInFrame, static_cast<int>(slotsPerFrame),
+                                                      packetsPerSymbol, lastStream, fill, endsUnit);
+
+        // Write to output file, the sink adds the IFGs following the packet
+        OutputFile->WritePacket(batch.bytes.data() + packet.offset, packet.length, packet.timestampNs);
+        if (packet.fragmentIndex + 1 == packet.fragmentCount)
+        {
+            OutputFile->EndGroup();
+            ++tally.oranPackets;
+            tally.fragmentedPackets += packet.fragmentCount > 1;
+        }
+        ++tally.ethernetFrames;
+        tally.frameBytes += packet.length;
+
+        // The idle time up to the next unit is filled with IFGs, the last fill of a radio frame by EndFrame
+        if (endsUnit)
+        {
+            if (packet.symbolId == 13 && slotInFrame + 1 == static_cast<int>(slotsPerFrame))
+                frameFill = fill;
+            else
+                OutputFile->FillIFGs(fill);
+        }
+    }
+    stats.Record(writerThread, RunStatistics::Write, writeBegin, slot);
+
+    // hand the batch back to the pool for the slot `window` positions ahead
+    if (pool)
+    {
+        {
+            std::lock_guard<std::mutex> guard(readyLock);
+            ready[slot % window] = 0;
+        }
+        if (slot + window < endSlot)
+        {
+            uint64_t nextSlot = slot + window;
+            pool->Submit([&, nextSlot](unsigned worker) { encodeSlot(nextSlot, worker); });
+        }
+    }
+
+    if ((slot + 1) % slotsPerFrame == 0)
+    {
+        // Add IFGs to be sent in the remaining time of the frame
+        OutputFile->EndFrame(frameFill);
+        stats.Progress(frameId + 1 - firstFrame, continuous ? 0 : endFrame - firstFrame, stats_progress_ms);
+    }
+}
+    // the slots already handed to the pool are finished before the state they use goes away
+    for (uint64_t slot = stopSlot; pool && slot < std::min(stopSlot + window, endSlot); ++slot)
+    {
+        std::unique_lock<std::mutex> guard(readyLock);
+        readyChanged.wait(guard, [&]() { return ready[slot % window] != 0; });
+    }
+    OutputFile->Close();
+    if (continuous)
+    {
+        std::cout << "Stopped after " << (stopSlot - firstSlot) / slotsPerFrame << " radio frames ("
+                  << (stopSlot - firstSlot) / slotsPerFrame * 10 << " ms of capture)" << std::endl;
+    }
+    if (rotation.Enabled())
+    {
+        std::cout << "Output rotated into " << rotation.Segments() << " segments, " << rotation.SegmentPath(rotation.FirstKept())
+                  << " to " << rotation.CurrentPath() << " on disk" << std::endl;
+    }
+    if (shardCount > 1)
+    {
+        std::cout << "Shard " << shardIndex << "/" << shardCount << ": radio frames " << firstFrame << "-" << endFrame - 1
+                  << " written to " << outputFilePath << std::endl;
+    }
+
+    RunStatistics::Tally& tally = stats.Counts();
+    tally.streams = generator.StreamCount();
+    tally.gapIFGs = scheduler.GapBytes();
+    tally.fillIFGs = scheduler.FillBytes();
+    tally.timelineNs = scheduler.DurationNs();
+    tally.overruns = scheduler.Overruns();
+    tally.linkUtilization = scheduler.LinkUtilization();
+    stats.Finish();
+    stats.PrintSummary();
+    if (!stats_file.empty() && !stats.WriteJson(stats_file))
+    {
+        std::cerr << "Error writing statistics file " << stats_file << std::endl;
+    }
+    if (!stats_trace.empty() && !stats.WriteTrace(stats_trace))
+    {
+        std::cerr << "Error writing trace file " << stats_trace << std::endl;
+    }
 
-    return 0;
+    return status;
 }
+#endif // MILESTONE2_NO_MAIN
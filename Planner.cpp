@@ -0,0 +1,372 @@
+// Fronthaul capacity planner: per-frame wire bytes, fragments, IFG fill, link utilization and headroom of a setup,
+// in closed form without generating packets (CapacityPlan), swept over a grid of settings
+// With bursts in the setup file, the fill bytes, utilization, occupancy and headroom are left empty (JSON null):
+// the plan does not place bursts on the timeline
+// Build: g++ -std=c++20 -O2 -pthread Planner.cpp -o Planner
+// Usage: Planner [--setup SetupFile.txt] [--scs list] [--nrb list] [--nrb-per-packet list] [--max-packet-size list]
+//                [--line-rate list] [--streams list] [--threads n] [--format csv|json] [--output file] [--fits-only]
+//   --setup            defaults of every swept setting and the fixed ones (compression, IFGs, fill unit, bursts)
+//   --scs ... --streams  values of ORAN.SCS, ORAN.MaxNRB, ORAN.NRBperpacket, Eth.MaxPacketSize, Eth.LineRate (Gbit/s)
+//                      and the eAxC stream count: a comma list (15,30,60), a range lo:hi or lo:hi:step, or both (1:8,16)
+//   --threads          threads evaluating the grid, 0 = one per CPU (default)
+//   --format           csv (default) or json, one row per combination of the grid
+//   --output           results file (default: stdout)
+//   --fits-only        only the combinations whose packets fit every fill unit and burst budget
+// Exit code 0 on success, 1 on a usage or IO error
+
+#define MILESTONE2_NO_MAIN
+#include "Milestone2.cpp"
+
+// One swept setting: its values, in order
+struct SweepAxis
+{
+    const char* option;
+    std::vector<int> values;
+
+    // "a,b,c", "lo:hi" or "lo:hi:step", mixed freely
+    bool Parse(const std::string& list)
+    {
+        values.clear();
+        std::istringstream items(list);
+        for (std::string item; std::getline(items, item, ',');)
+        {
+            int range[3] = { 0, 0, 1 };
+            int fields = 0;
+            const char* p = item.data();
+            const char* end = item.data() + item.size();
+            while (fields < 3)
+            {
+                auto [next, ec] = std::from_chars(p, end, range[fields]);
+                if (ec != std::errc())
+                    return false;
+                ++fields;
+                p = next;
+                if (p == end)
+                    break;
+                if (*p++ != ':')
+                    return false;
+            }
+            if (p != end || range[2] < 1)
+                return false;
+            if (fields == 1)
+                range[1] = range[0];
+            for (int64_t v = range[0]; v <= range[1]; v += range[2])
+            {
+                values.push_back(static_cast<int>(v));
+            }
+        }
+        return !values.empty();
+    }
+};
+
+class CapacitySweep
+{
+public:
+    enum Axis { SCS, MaxNRB, NRBPerPacket, MaxPacketSize, LineRate, Streams, Axes };
+
+    CapacitySweep(const CapacityPlan& base, bool json, bool fitsOnly) : base(base), json(json), fitsOnly(fitsOnly)
+    {
+        static const char* options[Axes] = { "--scs", "--nrb", "--nrb-per-packet", "--max-packet-size", "--line-rate", "--streams" };
+        for (int a = 0; a < Axes; ++a)
+        {
+            axes[a].option = options[a];
+        }
+        axes[SCS].values = { base.scs };
+        axes[MaxNRB].values = { base.maxNrb };
+        axes[NRBPerPacket].values = { base.nrbPerPacket };
+        axes[MaxPacketSize].values = { base.maxPacketSize };
+        axes[LineRate].values = { base.lineRate };
+        axes[Streams].values = { base.streams };
+    }
+
+    SweepAxis* Find(const std::string& option)
+    {
+        for (SweepAxis& axis : axes)
+        {
+            if (option == axis.option)
+                return &axis;
+        }
+        return nullptr;
+    }
+
+    uint64_t Size() const
+    {
+        uint64_t size = 1;
+        for (const SweepAxis& axis : axes)
+        {
+            size *= axis.values.size();
+        }
+        return size;
+    }
+
+    // Evaluate the whole grid, `threads` contiguous chunks of each batch at a time, and write the rows in grid order
+    bool Run(unsigned threads, std::ostream& out)
+    {
+        out << (json ? "[" : "scs,max_nrb,nrb_per_packet,max_packet_size,line_rate_gbps,streams,status,ethernet_frames,"
+                             "oran_packets,fragmented_packets,packet_bytes,gap_bytes,fill_bytes,link_utilization,"
+                             "occupancy,headroom,min_line_rate_gbps,burst_us\n");
+        const uint64_t size = Size();
+        const uint64_t batchSize = std::max<uint64_t>(threads, 1) * 65536;
+        std::vector<std::string> chunks(threads);
+        bool first = true;
+        for (uint64_t batch = 0; batch < size; batch += batchSize)
+        {
+            const uint64_t batchEnd = std::min(size, batch + batchSize);
+            std::vector<std::thread> workers;
+            for (unsigned c = 0; c < threads; ++c)
+            {
+                uint64_t begin = batch + (batchEnd - batch) * c / threads, end = batch + (batchEnd - batch) * (c + 1) / threads;
+                auto work = [this, &chunks, c, begin, end]() { Evaluate(begin, end, chunks[c]); };
+                if (c + 1 < threads)
+                    workers.emplace_back(work);
+                else
+                    work();
+            }
+            for (std::thread& worker : workers)
+            {
+                worker.join();
+            }
+            for (std::string& chunk : chunks)
+            {
+                // every JSON row starts with ",\n"; the first of the array drops the comma
+                if (json && first && !chunk.empty())
+                {
+                    chunk.erase(0, 1);
+                    first = false;
+                }
+                out.write(chunk.data(), chunk.size());
+            }
+        }
+        out << (json ? "\n]\n" : "");
+        return static_cast<bool>(out);
+    }
+
+    uint64_t Fitting() const { return fitting; }
+
+private:
+    static const char* Status(const CapacityPlan& plan)
+    {
+        return !plan.valid ? "invalid" : plan.overrunUnits ? "overrun" : plan.BurstLimited() ? "burst" : "ok";
+    }
+
+    void Evaluate(uint64_t begin, uint64_t end, std::string& rows)
+    {
+        rows.clear();
+        uint64_t fits = 0;
+        CapacityPlan plan = base;
+        for (uint64_t index = begin; index < end; ++index)
+        {
+            // grid index to settings, the last axis varying fastest
+            uint64_t rest = index;
+            int values[Axes];
+            for (int a = Axes - 1; a >= 0; --a)
+            {
+                values[a] = axes[a].values[rest % axes[a].values.size()];
+                rest /= axes[a].values.size();
+            }
+            plan.scs = values[SCS];
+            plan.maxNrb = values[MaxNRB];
+            plan.nrbPerPacket = values[NRBPerPacket];
+            plan.maxPacketSize = values[MaxPacketSize];
+            plan.lineRate = values[LineRate];
+            plan.streams = values[Streams];
+            plan.Evaluate();
+            fits += plan.Fits();
+            if (fitsOnly && !plan.Fits())
+                continue;
+            AppendRow(plan, rows);
+        }
+        std::lock_guard<std::mutex> guard(countLock);
+        fitting += fits;
+    }
+
+    // Longest row: 18 columns of at most 20 digits (64 for a value too large for fixed point), their JSON names
+    static const size_t MaxRowSize = 768;
+
+    static char* Append(char* p, const char* text)
+    {
+        size_t length = std::strlen(text);
+        std::memcpy(p, text, length);
+        return p + length;
+    }
+
+    static char* Append(char* p, uint64_t value)
+    {
+        return std::to_chars(p, p + 20, value).ptr;
+    }
+
+    // Fixed point with `precision` decimals, formatted as integers: several times faster than to_chars of a double
+    static char* Append(char* p, double value, int precision)
+    {
+        static const int64_t scales[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+        if (!(std::fabs(value) < 1e12))
+            return std::to_chars(p, p + 64, value, std::chars_format::fixed, precision).ptr;
+        const int64_t scaled = std::llround(std::fabs(value) * scales[precision]);
+        if (value < 0 && scaled)
+            *p++ = '-';
+        p = Append(p, static_cast<uint64_t>(scaled / scales[precision]));
+        *p = '.';
+        int64_t fraction = scaled % scales[precision];
+        for (int digit = precision; digit > 0; --digit, fraction /= 10)
+        {
+            p[digit] = static_cast<char>('0' + fraction % 10);
+        }
+        return p + precision + 1;
+    }
+
+    // One CSV line, or one JSON object after ",\n", at the end of `rows`
+    void AppendRow(const CapacityPlan& plan, std::string& rows) const
+    {
+        static const char* names[] = { "scs", "max_nrb", "nrb_per_packet", "max_packet_size", "line_rate_gbps", "streams",
+                                       "status", "ethernet_frames", "oran_packets", "fragmented_packets", "packet_bytes",
+                                       "gap_bytes", "fill_bytes", "link_utilization", "occupancy", "headroom",
+                                       "min_line_rate_gbps", "burst_us" };
+        const size_t used = rows.size();
+        if (rows.capacity() < used + MaxRowSize)
+            rows.reserve(std::max(2 * rows.capacity(), used + MaxRowSize));
+        rows.resize(used + MaxRowSize);
+        char* p = rows.data() + used;
+        int column = 0;
+        auto field = [&]()
+        {
+            if (json)
+            {
+                p = Append(p, column ? ",\"" : ",\n{\"");
+                p = Append(p, names[column]);
+                *p++ = '"';
+                *p++ = ':';
+            }
+            else if (column)
+                *p++ = ',';
+            ++column;
+            return p;
+        };
+        p = Append(field(), static_cast<uint64_t>(plan.scs));
+        p = Append(field(), static_cast<uint64_t>(plan.maxNrb));
+        p = Append(field(), static_cast<uint64_t>(plan.nrbPerPacket));
+        p = Append(field(), static_cast<uint64_t>(plan.maxPacketSize));
+        p = Append(field(), static_cast<uint64_t>(plan.lineRate));
+        p = Append(field(), static_cast<uint64_t>(plan.streams));
+        p = Append(Append(Append(field(), json ? "\"" : ""), Status(plan)), json ? "\"" : "");
+        p = Append(field(), plan.ethernetFrames);
+        p = Append(field(), plan.oranPackets);
+        p = Append(field(), plan.fragmentedPackets);
+        p = Append(field(), plan.packetBytes);
+        p = Append(field(), plan.gapBytes);
+        // timeline values, not planned with bursts
+        const char* unplanned = json ? "null" : "";
+        p = plan.Bursts() ? Append(field(), unplanned) : Append(field(), plan.fillBytes);
+        p = plan.Bursts() ? Append(field(), unplanned) : Append(field(), plan.LinkUtilization(), 6);
+        p = plan.Bursts() ? Append(field(), unplanned) : Append(field(), plan.Occupancy(), 6);
+        p = plan.Bursts() ? Append(field(), unplanned) : Append(field(), plan.Headroom(), 6);
+        p = Append(field(), static_cast<uint64_t>(plan.minLineRate));
+        p = Append(field(), plan.burstUs, 3);
+        *p++ = json ? '}' : '\n';
+        rows.resize(p - rows.data());
+    }
+
+    CapacityPlan base;
+    SweepAxis axes[Axes];
+    bool json, fitsOnly;
+    std::mutex countLock;
+    uint64_t fitting = 0;
+};
+
+int main(int argc, char* argv[])
+{
+    std::string setupFilePath = "SetupFile.txt";
+    std::string format = "csv", outputPath;
+    std::vector<std::pair<std::string, std::string>> sweeps;
+    unsigned threads = 0;
+    bool fitsOnly = false, usage = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--setup" && i + 1 < argc)
+            setupFilePath = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = std::stoi(argv[++i]);
+        else if (arg == "--format" && i + 1 < argc)
+            format = argv[++i];
+        else if (arg == "--output" && i + 1 < argc)
+            outputPath = argv[++i];
+        else if (arg == "--fits-only")
+            fitsOnly = true;
+        else if (arg.compare(0, 2, "--") == 0 && i + 1 < argc)
+            sweeps.emplace_back(arg, argv[++i]);
+        else
+            usage = true;
+    }
+    if (usage || (format != "csv" && format != "json"))
+    {
+        std::cerr << "Usage: " << argv[0] << " [--setup SetupFile.txt] [--scs list] [--nrb list] [--nrb-per-packet list]"
+                  << " [--max-packet-size list] [--line-rate list] [--streams list] [--threads n] [--format csv|json]"
+                  << " [--output file] [--fits-only]" << std::endl;
+        return 1;
+    }
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    GeneratorConfig config;
+    if (!config.Load(setupFilePath))
+    {
+        return 1;
+    }
+    CapacityPlan base;
+    std::vector<uint8_t> eAxCIds;
+    if (!IQCompressor::Parse(config.compMethod, config.iqWidth, base.compression))
+    {
+        std::cerr << "Unsupported IQ compression: " << config.compMethod << " at " << config.iqWidth << " bits" << std::endl;
+        return 1;
+    }
+    if (!StreamSet::ParseIds(config.eAxC, eAxCIds) || !PacketScheduler::ParseFillUnit(config.ifgFill, base.fillUnit))
+    {
+        std::cerr << "Invalid ORAN.eAxC or Eth.IFGFill in " << setupFilePath << std::endl;
+        return 1;
+    }
+    base.scs = config.scs;
+    base.maxNrb = config.maxNrb;
+    base.nrbPerPacket = config.nrbPerPacket;
+    base.maxPacketSize = config.maxPacketSize;
+    base.lineRate = config.lineRate;
+    base.streams = static_cast<int>(eAxCIds.size());
+    base.minIFGs = config.minIFGsPerPacket;
+    base.burstSize = config.burstSize;
+    base.burstPeriodUs = config.burstPeriodicityUs;
+
+    CapacitySweep sweep(base, format == "json", fitsOnly);
+    for (const auto& [option, list] : sweeps)
+    {
+        SweepAxis* axis = sweep.Find(option);
+        if (!axis || !axis->Parse(list))
+        {
+            std::cerr << "Invalid " << option << ": " << list << std::endl;
+            return 1;
+        }
+    }
+
+    std::ofstream file;
+    if (!outputPath.empty())
+    {
+        file.open(outputPath, std::ios::binary);
+        if (!file)
+        {
+            std::cerr << "Error opening " << outputPath << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = outputPath.empty() ? cout : file;
+    std::ostream& report = outputPath.empty() ? std::cerr : cout;
+
+    auto start = std::chrono::steady_clock::now();
+    if (!sweep.Run(threads, out))
+    {
+        std::cerr << "Error writing " << (outputPath.empty() ? "the results" : outputPath) << std::endl;
+        return 1;
+    }
+    out.flush();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report << "Planned " << sweep.Size() << " configurations in " << seconds << " s, "
+           << sweep.Size() / std::max(seconds, 1e-9) / 1e6 << " M configurations/s, " << sweep.Fitting() << " fit" << endl;
+    return 0;
+}
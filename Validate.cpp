@@ -0,0 +1,439 @@
+// Checks a capture written by Milestone2 (text, pcap or pcapng) against the setup file it was generated with
+// The capture is checked window by window, so memory does not grow with it; LZ4 or zstd compressed captures
+// (Output.Compression) have the blocks of each window decoded in parallel
+// Build: g++ -std=c++20 -O2 -pthread Validate.cpp -o Validate
+// Usage: Validate [--setup SetupFile.txt] [--threads n] [--max-errors n] capture
+//   --setup       setup file of the run (default: SetupFile.txt)
+//   --threads     threads for decoding and per-frame checks, 0 = one per CPU (default)
+//   --max-errors  violations listed in full (default 20), all of them are counted
+// Exit code 0 if the capture is valid, 2 if violations were found, 1 if it could not be read
+
+#define MILESTONE2_NO_MAIN
+#include "Milestone2.cpp"
+
+enum ViolationKind { Framing, FCSMismatch, MACHeader, ECPRIHeader, ECPRILength, FrameSize, SeqIdGap, Timing,
+                     Progression, PRBCoverage, Fragmentation, CompressionHeader, ViolationKinds };
+
+static const char* ViolationName(ViolationKind kind)
+{
+    static const char* names[ViolationKinds] = { "framing", "FCS", "MAC header", "eCPRI header", "eCPRI length",
+                                                 "frame size", "SeqId", "timing", "progression", "PRB coverage",
+                                                 "fragmentation", "udCompHdr" };
+    return names[kind];
+}
+
+struct Violation
+{
+    size_t frame;
+    ViolationKind kind;
+    std::string detail;
+};
+
+// Collects violations: counted by kind, the first `keep` (in frame order) with their details
+class ViolationLog
+{
+public:
+    explicit ViolationLog(size_t keep = 0) : keep(keep), counts(ViolationKinds, 0) {}
+
+    void Add(size_t frame, ViolationKind kind, const std::string& detail)
+    {
+        ++counts[kind];
+        if (kept.size() < keep)
+            kept.push_back({ frame, kind, detail });
+    }
+
+    // Merge a log of frames after the ones already added
+    void Append(const ViolationLog& other)
+    {
+        for (int k = 0; k < ViolationKinds; ++k)
+            counts[k] += other.counts[k];
+        for (const Violation& v : other.kept)
+            if (kept.size() < keep)
+                kept.push_back(v);
+    }
+
+    void Sort()
+    {
+        std::stable_sort(kept.begin(), kept.end(), [](const Violation& a, const Violation& b) { return a.frame < b.frame; });
+    }
+
+    uint64_t Total() const { return std::accumulate(counts.begin(), counts.end(), uint64_t(0)); }
+
+    size_t keep;
+    std::vector<uint64_t> counts;
+    std::vector<Violation> kept;
+};
+
+// Header fields of one frame needed by the sequential checks
+struct FrameFields
+{
+    uint8_t eAxC;
+    uint8_t seqId;
+    uint16_t ecpriSize;                     // bytes after the eCPRI header
+    uint8_t section[ORAN_Packet::HeaderSize + ORAN_Packet::CompressionHeaderSize];  // start of the eCPRI payload
+};
+
+class CaptureValidator
+{
+public:
+    CaptureValidator(CaptureReader& capture, const IQCompressor& compression, size_t maxErrors)
+        : capture(capture), compression(compression), log(maxErrors)
+    {
+        destAddress = macAddressToUInt64(Dest_Address);
+        sourceAddress = macAddressToUInt64(Source_Address);
+        prbs = static_cast<int>(oran_Maxprb);
+        streamOf.fill(-1);
+    }
+
+    // Window by window: the per-frame checks on `threads` threads, then the checks that follow the frame order, on
+    // the header fields of the window
+    void Run(unsigned threads)
+    {
+        while (capture.NextWindow())
+        {
+            const size_t first = capture.WindowFirst(), count = capture.WindowLast() - first;
+            fieldsFirst = first;
+            fields.resize(count);
+            size_t chunks = std::max<size_t>(1, std::min<size_t>(threads, count / 4096));
+            std::vector<ViolationLog> logs(chunks, ViolationLog(log.keep));
+            std::vector<std::thread> workers;
+            for (size_t c = 0; c < chunks; ++c)
+            {
+                size_t begin = first + count * c / chunks, end = first + count * (c + 1) / chunks;
+                auto work = [&, c, begin, end]() { CheckFrames(begin, end, logs[c]); };
+                if (c + 1 < chunks)
+                    workers.emplace_back(work);
+                else
+                    work();
+            }
+            for (std::thread& worker : workers)
+            {
+                worker.join();
+            }
+            for (const ViolationLog& chunkLog : logs)
+            {
+                log.Append(chunkLog);
+            }
+            CheckSequence(first, capture.WindowLast());
+        }
+        if (current >= 0)
+            CloseSymbol(capture.Frames().size(), current);
+        log.Sort();
+    }
+
+    const ViolationLog& Log() const { return log; }
+    uint64_t Sections() const { return sections; }
+    uint64_t Symbols() const { return symbols; }
+    size_t Streams() const { return streams.size(); }
+
+private:
+    // Stateless checks of every frame: FCS, MAC header, eCPRI header and length, frame size
+    void CheckFrames(size_t begin, size_t end, ViolationLog& out)
+    {
+        const std::vector<CaptureReader::Frame>& frames = capture.Frames();
+        const eCPRI_Packet reference;
+        const size_t minimum = EthernetPacket::HeaderSize + eCPRI_Packet::HeaderSize + EthernetPacket::FCSSize;
+        for (size_t i = begin; i < end; ++i)
+        {
+            const CaptureReader::Frame& frame = frames[i];
+            const uint8_t* bytes = capture.FrameData(frame);
+            FrameFields& f = fields[i - fieldsFirst];
+            std::memset(&f, 0, sizeof(f));
+            if (frame.length < minimum)
+            {
+                out.Add(i, Framing, "runt frame of " + std::to_string(frame.length) + " bytes");
+                f.ecpriSize = UINT16_MAX;  // skipped by the sequential checks
+                continue;
+            }
+
+            size_t covered = frame.length - EthernetPacket::FCSSize;
+            uint32_t fcs = bytes[covered] | bytes[covered + 1] << 8 | bytes[covered + 2] << 16 |
+                           static_cast<uint32_t>(bytes[covered + 3]) << 24;
+            uint32_t crc = CRC32Engine::Compute(bytes, covered);
+            if (crc != fcs)
+                out.Add(i, FCSMismatch, "FCS " + Hex(fcs, 8) + ", computed " + Hex(crc, 8));
+
+            uint64_t dest = 0, source = 0;
+            for (int b = 0; b < 6; ++b)
+            {
+                dest = dest << 8 | bytes[b];
+                source = source << 8 | bytes[6 + b];
+            }
+            uint16_t etherType = static_cast<uint16_t>(bytes[12] << 8 | bytes[13]);
+            if (dest != destAddress || source != sourceAddress || etherType != EthernetPacket::EtherType)
+                out.Add(i, MACHeader, "addresses " + Hex(dest, 12) + " <- " + Hex(source, 12) + ", EtherType " + Hex(etherType, 4));
+
+            const uint8_t* ecpri = bytes + EthernetPacket::HeaderSize;
+            if (ecpri[0] != reference.eCPRI_Version || ecpri[1] != reference.eCPRI_Message)
+                out.Add(i, ECPRIHeader, "revision " + Hex(ecpri[0], 2) + ", message type " + Hex(ecpri[1], 2));
+            size_t ecpriSize = static_cast<size_t>(ecpri[2]) << 8 | ecpri[3];
+            size_t carried = frame.length - minimum;
+            if (ecpriSize != carried)
+                out.Add(i, ECPRILength, "payload size " + std::to_string(ecpriSize) + ", frame carries " + std::to_string(carried));
+            if (frame.length - EthernetPacket::HeaderSize - EthernetPacket::FCSSize > static_cast<size_t>(MaxPacketSize))
+                out.Add(i, FrameSize, std::to_string(frame.length - EthernetPacket::HeaderSize - EthernetPacket::FCSSize) +
+                                      " payload bytes, Eth.MaxPacketSize " + std::to_string(MaxPacketSize));
+
+            f.eAxC = ecpri[4];
+            f.seqId = ecpri[5];
+            f.ecpriSize = static_cast<uint16_t>(carried);
+            std::memcpy(f.section, ecpri + eCPRI_Packet::HeaderSize, std::min(carried, sizeof(f.section)));
+        }
+    }
+
+    // Per-stream state of the sequential checks
+    struct StreamState
+    {
+        int lastSeqId = -1;
+        std::vector<uint64_t> covered;   // PRBs of the current symbol
+    };
+
+    // Checks that depend on the frame order, for frames [begin, end) after the ones before: SeqId continuity per
+    // eAxC, timing, symbol progression, whole-PRB sections and PRB coverage of every symbol
+    void CheckSequence(size_t begin, size_t end)
+    {
+        const size_t sectionSize = ORAN_Packet::HeaderSize + (compression.Legacy() ? 0 : ORAN_Packet::CompressionHeaderSize);
+        const uint64_t symbolsPerFrame = 10ull * slots * 14;
+        const uint64_t period = 256 * symbolsPerFrame;  // FrameID wraps at 256
+        for (size_t i = begin; i < end; ++i)
+        {
+            const FrameFields& f = fields[i - fieldsFirst];
+            if (f.ecpriSize == UINT16_MAX)
+                continue;
+            CheckTiming(i);
+
+            if (streamOf[f.eAxC] < 0)
+            {
+                streamOf[f.eAxC] = static_cast<int>(streams.size());
+                streams.emplace_back();
+                streams.back().covered.assign((prbs + 63) / 64, 0);
+                eAxCIds.push_back(f.eAxC);
+            }
+            StreamState& stream = streams[streamOf[f.eAxC]];
+            if (stream.lastSeqId >= 0 && f.seqId != ((stream.lastSeqId + 1) & 0xFF))
+                log.Add(i, SeqIdGap, "eAxC " + std::to_string(f.eAxC) + ": SeqId " + std::to_string(f.seqId) +
+                                     ", expected " + std::to_string((stream.lastSeqId + 1) & 0xFF));
+            stream.lastSeqId = f.seqId;
+
+            ++sections;
+            if (f.ecpriSize < sectionSize)
+            {
+                log.Add(i, ECPRILength, "ORAN packet of " + std::to_string(f.ecpriSize) + " bytes, shorter than its section header");
+                continue;
+            }
+            const uint8_t* h = f.section;
+            if (!compression.Legacy() && h[8] != compression.UdCompHdr())
+                log.Add(i, CompressionHeader, Hex(h[8], 2) + ", expected " + Hex(compression.UdCompHdr(), 2));
+
+            int frameId = h[1], subframeId = h[2] >> 4, slotId = (h[2] & 0x0F) << 2 | h[3] >> 6, symbolId = h[3] & 0x3F;
+            int startPrb = (h[5] & 0x03) << 8 | h[6];
+            int numPrb = h[7] == 0 ? prbs : h[7];
+            if (subframeId >= 10 || slotId >= slots || symbolId >= 14)
+            {
+                log.Add(i, Progression, "invalid position " + Position(frameId, subframeId, slotId, symbolId));
+                continue;
+            }
+            int64_t symbol = ((static_cast<int64_t>(frameId) * 10 + subframeId) * slots + slotId) * 14 + symbolId;
+            if (symbol != current)
+            {
+                if (current >= 0 && symbol != static_cast<int64_t>((current + 1) % period))
+                {
+                    int64_t next = (current + 1) % period;
+                    log.Add(i, Progression, Position(frameId, subframeId, slotId, symbolId) + " after " + SymbolPosition(current) +
+                                            ", expected " + SymbolPosition(next));
+                }
+                if (current >= 0)
+                    CloseSymbol(i, current);
+                current = symbol;
+            }
+
+            // Fragments are sections of whole PRBs with their own header: a frame never carries part of a section
+            size_t oranSize = sectionSize + static_cast<size_t>(numPrb) * compression.PRBBytes();
+            if (f.ecpriSize > oranSize)
+                log.Add(i, ECPRILength, std::to_string(f.ecpriSize) + " bytes for " + std::to_string(numPrb) + " PRBs of " +
+                                        std::to_string(compression.PRBBytes()) + " bytes");
+            else if (f.ecpriSize < oranSize)
+                log.Add(i, Fragmentation, "section of " + std::to_string(f.ecpriSize) + " bytes for " + std::to_string(numPrb) +
+                                          " PRBs, " + std::to_string(oranSize - f.ecpriSize) + " bytes missing");
+
+            if (startPrb + numPrb > prbs)
+            {
+                log.Add(i, PRBCoverage, "PRBs " + std::to_string(startPrb) + "-" + std::to_string(startPrb + numPrb - 1) +
+                                        " beyond ORAN.MaxNRB " + std::to_string(prbs));
+                continue;
+            }
+            bool overlap = false;
+            for (int prb = startPrb; prb < startPrb + numPrb; ++prb)
+            {
+                uint64_t bit = 1ull << (prb % 64);
+                overlap |= (stream.covered[prb / 64] & bit) != 0;
+                stream.covered[prb / 64] |= bit;
+            }
+            if (overlap)
+                log.Add(i, PRBCoverage, "eAxC " + std::to_string(f.eAxC) + ": PRBs " + std::to_string(startPrb) + "-" +
+                                        std::to_string(startPrb + numPrb - 1) + " overlap earlier packets of the symbol");
+        }
+    }
+
+    // End of a symbol: every stream seen so far must have carried all its PRBs
+    void CloseSymbol(size_t frame, int64_t symbol)
+    {
+        ++symbols;
+        for (size_t s = 0; s < streams.size(); ++s)
+        {
+            StreamState& stream = streams[s];
+            int count = 0;
+            for (uint64_t& word : stream.covered)
+            {
+                count += __builtin_popcountll(word);
+                word = 0;
+            }
+            if (count != prbs)
+                log.Add(frame, PRBCoverage, "eAxC " + std::to_string(eAxCIds[s]) + " " + SymbolPosition(symbol) + ": " +
+                                            std::to_string(count) + " of " + std::to_string(prbs) + " PRBs");
+        }
+    }
+
+    // Packets may not overlap on the wire: the binary formats give their start times, the text format the IFGs
+    // between them. Each packet is followed by at least Eth.MinNumOfIFGsPerPacket IFGs plus the 4-byte realignment
+    void CheckTiming(size_t i)
+    {
+        if (i == 0)
+            return;
+        const std::vector<CaptureReader::Frame>& frames = capture.Frames();
+        size_t previous = EthernetPacket::PreambleSize + frames[i - 1].length;
+        size_t minimumGap = EthernetPacket::GapIFGs(previous, MinNumOfIFGsPerPacket);
+        if (capture.GetFormat() == CaptureReader::Text)
+        {
+            if (frames[i].ifgsBefore < minimumGap)
+                log.Add(i, Timing, std::to_string(frames[i].ifgsBefore) + " IFGs after the previous packet, at least " +
+                                   std::to_string(minimumGap) + " needed");
+            return;
+        }
+        // timestamps are rounded down to the ns, allow 1 ns
+        uint64_t wireNs = (previous + minimumGap) * 8 / std::max(LineRate, 1);
+        uint64_t start = frames[i - 1].timestampNs, next = frames[i].timestampNs;
+        if (next < start || next - start + 1 < wireNs)
+            log.Add(i, Timing, "starts " + std::to_string(static_cast<int64_t>(next - start)) + " ns after the previous packet, " +
+                               std::to_string(wireNs) + " ns needed");
+    }
+
+    static std::string Hex(uint64_t value, int digits)
+    {
+        std::ostringstream text;
+        text << "0x" << std::hex << std::setw(digits) << std::setfill('0') << value;
+        return text.str();
+    }
+
+    static std::string Position(int frameId, int subframeId, int slotId, int symbolId)
+    {
+        return "frame " + std::to_string(frameId) + " subframe " + std::to_string(subframeId) + " slot " +
+               std::to_string(slotId) + " symbol " + std::to_string(symbolId);
+    }
+
+    std::string SymbolPosition(int64_t symbol) const
+    {
+        return Position(static_cast<int>(symbol / (140 * slots)), static_cast<int>(symbol / (14 * slots) % 10),
+                        static_cast<int>(symbol / 14 % slots), static_cast<int>(symbol % 14));
+    }
+
+    CaptureReader& capture;
+    IQCompressor compression;
+    ViolationLog log;
+    std::vector<FrameFields> fields;     // of the window, from frame fieldsFirst on
+    size_t fieldsFirst = 0;
+    std::vector<StreamState> streams;
+    std::array<int, 256> streamOf;       // index in `streams` of each eAxC
+    int64_t current = -1;                // symbol of the last section
+    std::vector<uint8_t> eAxCIds;
+    uint64_t destAddress, sourceAddress;
+    int prbs;
+    uint64_t sections = 0;
+    uint64_t symbols = 0;
+};
+
+int main(int argc, char* argv[])
+{
+    std::string setupFilePath = "SetupFile.txt";
+    std::string capturePath;
+    unsigned threads = 0;
+    size_t maxErrors = 20;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--setup" && i + 1 < argc)
+            setupFilePath = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = std::stoi(argv[++i]);
+        else if (arg == "--max-errors" && i + 1 < argc)
+            maxErrors = std::stoul(argv[++i]);
+        else if (capturePath.empty() && arg[0] != '-')
+            capturePath = arg;
+        else
+        {
+            capturePath.clear();
+            break;
+        }
+    }
+    if (capturePath.empty())
+    {
+        std::cerr << "Usage: " << argv[0] << " [--setup SetupFile.txt] [--threads n] [--max-errors n] <capture>" << std::endl;
+        return 1;
+    }
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    if (!readSetupFile(setupFilePath))
+    {
+        return 1;
+    }
+    // Calculations() reports to the console
+    std::streambuf* console = cout.rdbuf(nullptr);
+    Calculations();
+    cout.rdbuf(console);
+
+    IQCompressor compression;
+    if (!IQCompressor::Parse(oran_compMethod, oran_iqWidth, compression))
+    {
+        std::cerr << "Unsupported IQ compression: " << oran_compMethod << " at " << oran_iqWidth << " bits" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    CaptureReader capture;
+    if (!capture.Open(capturePath, threads))
+    {
+        std::cerr << "Error opening capture " << capturePath << std::endl;
+        return 1;
+    }
+    CaptureValidator validator(capture, compression, maxErrors);
+    validator.Run(threads);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const ViolationLog& log = validator.Log();
+    for (const Violation& v : log.kept)
+    {
+        cout << "frame " << v.frame << ": " << ViolationName(v.kind) << ": " << v.detail << endl;
+    }
+    cout << "Checked " << capture.Frames().size() << " frames (" << validator.Sections() << " ORAN sections, "
+         << validator.Streams() << " eAxC streams, " << validator.Symbols() << " symbols) of a "
+         << CaptureReader::FormatName(capture.GetFormat()) << " capture in " << seconds << " s, "
+         << capture.FileSize() / std::max(seconds, 1e-9) / 1e6 << " MB/s" << endl;
+    if (!capture.Error().empty())
+    {
+        cout << "Capture unreadable after frame " << capture.Frames().size() << ": " << capture.Error() << endl;
+    }
+    if (log.Total() == 0 && capture.Error().empty())
+    {
+        cout << "No violations." << endl;
+        return 0;
+    }
+    cout << log.Total() << " violations:";
+    for (int k = 0; k < ViolationKinds; ++k)
+    {
+        if (log.counts[k] != 0)
+            cout << " " << ViolationName(static_cast<ViolationKind>(k)) << " " << log.counts[k];
+    }
+    cout << endl;
+    return 2;
+}